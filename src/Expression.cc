@@ -0,0 +1,480 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Util.hh>
+#include <gz/math/Helpers.hh>
+#include <gz/sim/Util.hh>
+
+#include "Expression.hh"
+#include "Test.hh"
+#include "Trigger.hh"
+
+using namespace gz;
+using namespace test;
+
+namespace
+{
+  /// \brief Comparison operators supported in expressions.
+  enum class Operator
+  {
+    EQUAL,
+    NOT_EQUAL,
+    GREATER_EQUAL,
+    LESS_EQUAL,
+    GREATER,
+    LESS
+  };
+
+  /// \brief Pose properties that can be referenced in expressions.
+  enum class PoseProperty
+  {
+    X,
+    Y,
+    Z,
+    ROLL,
+    PITCH,
+    YAW
+  };
+
+  /// \brief A constant number, or a time string converted to a number.
+  class LiteralNode : public ValueNode
+  {
+    public: explicit LiteralNode(double _value) : value(_value) {}
+
+    // Documentation inherited
+    public: std::optional<double> Evaluate(const sim::UpdateInfo &,
+                Test *, const sim::EntityComponentManager &) override
+            {
+              return this->value;
+            }
+
+    private: double value;
+  };
+
+  /// \brief The "simulation.time" operand.
+  class SimTimeNode : public ValueNode
+  {
+    // Documentation inherited
+    public: std::optional<double> Evaluate(const sim::UpdateInfo &_info,
+                Test *, const sim::EntityComponentManager &) override
+            {
+              return std::chrono::duration<double>(_info.simTime).count();
+            }
+  };
+
+  /// \brief A "<entity>.pose.<property>" operand.
+  class PoseNode : public ValueNode
+  {
+    public: PoseNode(const std::string &_entityName,
+                PoseProperty _property)
+            : entityName(_entityName), property(_property) {}
+
+    // Documentation inherited
+    public: std::optional<double> Evaluate(const sim::UpdateInfo &,
+                Test *_test, const sim::EntityComponentManager &_ecm) override
+            {
+              // Only resolve the name when the test's entity cache has
+              // been invalidated.
+              if (this->generation != _test->EntityGeneration())
+              {
+                this->entity = _test->EntityByName(this->entityName, _ecm);
+                this->generation = _test->EntityGeneration();
+              }
+
+              if (this->entity == sim::kNullEntity)
+                return std::nullopt;
+
+              math::Pose3d pose = sim::worldPose(this->entity, _ecm);
+              switch (this->property)
+              {
+                case PoseProperty::X:
+                  return pose.Pos().X();
+                case PoseProperty::Y:
+                  return pose.Pos().Y();
+                case PoseProperty::Z:
+                  return pose.Pos().Z();
+                case PoseProperty::ROLL:
+                  return pose.Rot().Euler().X();
+                case PoseProperty::PITCH:
+                  return pose.Rot().Euler().Y();
+                case PoseProperty::YAW:
+                  return pose.Rot().Euler().Z();
+              }
+              return std::nullopt;
+            }
+
+    private: std::string entityName;
+    private: PoseProperty property;
+
+    /// \brief The resolved entity.
+    private: sim::Entity entity{sim::kNullEntity};
+
+    /// \brief Entity cache generation in which the entity was resolved.
+    private: uint64_t generation{std::numeric_limits<uint64_t>::max()};
+  };
+
+  /// \brief Statistics of the commands run by a trigger, that can be
+  /// referenced in expressions.
+  enum class CommandStat
+  {
+    EXIT_CODE,
+    CPU_TIME,
+    MAX_RSS
+  };
+
+  /// \brief A "<trigger>.exit_code", "<trigger>.cpu_time" or
+  /// "<trigger>.max_rss" operand. CPU time is in seconds, and the maximum
+  /// resident set size is in kilobytes.
+  class CommandStatNode : public ValueNode
+  {
+    public: CommandStatNode(const std::string &_triggerName,
+                CommandStat _stat)
+            : triggerName(_triggerName), stat(_stat) {}
+
+    // Documentation inherited
+    public: std::optional<double> Evaluate(const sim::UpdateInfo &,
+                Test *_test, const sim::EntityComponentManager &) override
+            {
+              // Triggers may reference triggers that are loaded after
+              // them, so the trigger is bound on first use.
+              if (!this->trigger)
+                this->trigger = _test->TriggerByName(this->triggerName);
+              if (!this->trigger)
+                return std::nullopt;
+
+              ProcessManager::Stats stats = this->trigger->CommandStats();
+              if (stats.exitCount == 0)
+                return std::nullopt;
+
+              switch (this->stat)
+              {
+                case CommandStat::EXIT_CODE:
+                  return stats.lastExitCode;
+                case CommandStat::CPU_TIME:
+                  return std::chrono::duration<double>(stats.cpuTime).count();
+                case CommandStat::MAX_RSS:
+                  return static_cast<double>(stats.maxRss);
+              }
+              return std::nullopt;
+            }
+
+    private: std::string triggerName;
+    private: CommandStat stat;
+
+    /// \brief The bound trigger, owned by the test.
+    private: Trigger *trigger{nullptr};
+  };
+
+  /// \brief A "<lhs> <op> <rhs>" expression.
+  class ComparisonExpression : public Expression
+  {
+    public: ComparisonExpression(Operator _op,
+                std::unique_ptr<ValueNode> _lhs,
+                std::unique_ptr<ValueNode> _rhs)
+            : op(_op), lhs(std::move(_lhs)), rhs(std::move(_rhs)) {}
+
+    // Documentation inherited
+    public: std::optional<bool> Evaluate(const sim::UpdateInfo &_info,
+                Test *_test, const sim::EntityComponentManager &_ecm) override
+            {
+              std::optional<double> lhsValue =
+                this->lhs->Evaluate(_info, _test, _ecm);
+              std::optional<double> rhsValue =
+                this->rhs->Evaluate(_info, _test, _ecm);
+              if (!lhsValue || !rhsValue)
+                return std::nullopt;
+
+              switch (this->op)
+              {
+                case Operator::EQUAL:
+                  return math::equal(*lhsValue, *rhsValue);
+                case Operator::NOT_EQUAL:
+                  return !math::equal(*lhsValue, *rhsValue);
+                case Operator::GREATER_EQUAL:
+                  return *lhsValue >= *rhsValue;
+                case Operator::LESS_EQUAL:
+                  return *lhsValue <= *rhsValue;
+                case Operator::GREATER:
+                  return *lhsValue > *rhsValue;
+                case Operator::LESS:
+                  return *lhsValue < *rhsValue;
+              }
+              return std::nullopt;
+            }
+
+    private: Operator op;
+    private: std::unique_ptr<ValueNode> lhs;
+    private: std::unique_ptr<ValueNode> rhs;
+  };
+
+  /// \brief A "[!]<trigger>.<function>(<param>)" expression.
+  class FunctionExpression : public Expression
+  {
+    public: FunctionExpression(const std::string &_triggerName,
+                const std::string &_functionName,
+                const std::string &_param, bool _negate)
+            : triggerName(_triggerName), functionName(_functionName),
+              param(_param), negate(_negate) {}
+
+    // Documentation inherited
+    public: std::optional<bool> Evaluate(const sim::UpdateInfo &,
+                Test *_test, const sim::EntityComponentManager &_ecm) override
+            {
+              // Bind the trigger function on first use. Triggers may
+              // reference triggers that are loaded after them, so this
+              // can't happen at compile time.
+              if (!this->function)
+              {
+                Trigger *trigger = _test->TriggerByName(this->triggerName);
+                if (!trigger)
+                  return std::nullopt;
+
+                this->function = trigger->Function(this->functionName);
+                if (!this->function)
+                {
+                  gzerr << "Trigger[" << this->triggerName
+                    << "] does not have function[" << this->functionName
+                    << "]\n";
+                  return std::nullopt;
+                }
+              }
+
+              // Resolve the parameter as a model name, only when the
+              // test's entity cache has been invalidated. A link or
+              // other entity with the same name is never a match.
+              if (this->generation != _test->EntityGeneration())
+              {
+                this->entity = _test->ModelByName(this->param, _ecm);
+                this->generation = _test->EntityGeneration();
+              }
+
+              bool result = (*this->function)(this->param, this->entity);
+              return this->negate ? !result : result;
+            }
+
+    private: std::string triggerName;
+    private: std::string functionName;
+    private: std::string param;
+    private: bool negate{false};
+
+    /// \brief The bound trigger function, owned by the trigger.
+    private: const TriggerFunction *function{nullptr};
+
+    /// \brief The entity named by the parameter, or kNullEntity.
+    private: sim::Entity entity{sim::kNullEntity};
+
+    /// \brief Entity cache generation in which the entity was resolved.
+    private: uint64_t generation{std::numeric_limits<uint64_t>::max()};
+  };
+
+  //////////////////////////////////////////////////
+  /// \brief Find the first comparison operator in a string.
+  /// \param[in] _str String to search.
+  /// \param[out] _op The operator that was found.
+  /// \param[out] _len Length of the operator string.
+  /// \return Position of the operator, or std::string::npos.
+  size_t findOperator(const std::string &_str, Operator &_op, size_t &_len)
+  {
+    for (size_t i = 0; i < _str.size(); ++i)
+    {
+      char next = i + 1 < _str.size() ? _str[i + 1] : '\0';
+      _len = 2;
+      if (_str[i] == '=' && next == '=')
+        _op = Operator::EQUAL;
+      else if (_str[i] == '!' && next == '=')
+        _op = Operator::NOT_EQUAL;
+      else if (_str[i] == '>' && next == '=')
+        _op = Operator::GREATER_EQUAL;
+      else if (_str[i] == '<' && next == '=')
+        _op = Operator::LESS_EQUAL;
+      else if (_str[i] == '>')
+      {
+        _op = Operator::GREATER;
+        _len = 1;
+      }
+      else if (_str[i] == '<')
+      {
+        _op = Operator::LESS;
+        _len = 1;
+      }
+      else
+        continue;
+      return i;
+    }
+    return std::string::npos;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Compile a numeric operand.
+  /// \param[in] _str The operand string.
+  /// \return The operand, or nullptr if the string is not valid.
+  std::unique_ptr<ValueNode> compileValue(const std::string &_str)
+  {
+    std::string str = common::trimmed(_str);
+    if (str.empty())
+      return nullptr;
+
+    // Try to parse the string as a double.
+    char *end = nullptr;
+    double value = std::strtod(str.c_str(), &end);
+    if (end != str.c_str() && *end == '\0')
+      return std::make_unique<LiteralNode>(value);
+
+    // Does the string contain dots?
+    size_t dot = str.find(".");
+    if (dot != std::string::npos)
+    {
+      std::vector<std::string> parts = common::split(str, ".");
+      if (parts.size() == 2 && parts[0] == "simulation" &&
+          parts[1] == "time")
+      {
+        return std::make_unique<SimTimeNode>();
+      }
+
+      if (parts.size() == 2)
+      {
+        static const std::map<std::string, CommandStat> kStats = {
+          {"exit_code", CommandStat::EXIT_CODE},
+          {"cpu_time", CommandStat::CPU_TIME},
+          {"max_rss", CommandStat::MAX_RSS}};
+
+        auto stat = kStats.find(common::trimmed(parts[1]));
+        if (stat != kStats.end())
+        {
+          return std::make_unique<CommandStatNode>(
+              common::trimmed(parts[0]), stat->second);
+        }
+      }
+
+      if (parts.size() == 3 && parts[1] == "pose")
+      {
+        static const std::map<std::string, PoseProperty> kProperties = {
+          {"x", PoseProperty::X},
+          {"y", PoseProperty::Y},
+          {"z", PoseProperty::Z},
+          {"roll", PoseProperty::ROLL},
+          {"pitch", PoseProperty::PITCH},
+          {"yaw", PoseProperty::YAW}};
+
+        auto prop = kProperties.find(common::trimmed(parts[2]));
+        if (prop == kProperties.end())
+        {
+          gzerr << "Unable to get pose value for string[" << parts[2]
+            << "]\n";
+          return nullptr;
+        }
+        return std::make_unique<PoseNode>(parts[0], prop->second);
+      }
+    }
+    else if (math::isTimeString(str))
+    {
+      return std::make_unique<LiteralNode>(
+          static_cast<double>(math::stringToDuration(str).count()));
+    }
+
+    return nullptr;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Compile a trigger function call.
+  /// \param[in] _str The function call string.
+  /// \return The expression, or nullptr if the string is not valid.
+  std::unique_ptr<Expression> compileFunction(const std::string &_str)
+  {
+    std::string str = common::trimmed(_str);
+    size_t dot = str.find(".");
+    if (dot == std::string::npos)
+      return nullptr;
+
+    std::string triggerName = common::trimmed(str.substr(0, dot));
+
+    // Check if there is a negation
+    bool negate = false;
+    if (!triggerName.empty() && triggerName[0] == '!')
+    {
+      negate = true;
+      triggerName.erase(0, 1);
+    }
+
+    std::string function = common::trimmed(str.substr(dot + 1));
+    size_t parenStart = function.find("(");
+    size_t parenEnd = function.rfind(")");
+    if (triggerName.empty() || parenStart == std::string::npos ||
+        parenEnd == std::string::npos || parenEnd < parenStart)
+    {
+      return nullptr;
+    }
+
+    return std::make_unique<FunctionExpression>(triggerName,
+        common::trimmed(function.substr(0, parenStart)),
+        common::trimmed(function.substr(parenStart + 1,
+            parenEnd - parenStart - 1)),
+        negate);
+  }
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<Expression> Expression::Compile(const std::string &_str)
+{
+  // Strip out the beginning "${{" and ending "}}"
+  std::string str = _str;
+  size_t startIdx = str.find("${{");
+  if (startIdx != std::string::npos)
+  {
+    startIdx += 3;
+    size_t endIdx = str.find("}}", startIdx);
+    str = str.substr(startIdx, endIdx - startIdx);
+  }
+  str = common::trimmed(str);
+
+  std::unique_ptr<Expression> result;
+
+  // Attempt to compile the expression as an equation.
+  Operator op;
+  size_t opLen = 0;
+  size_t opIdx = findOperator(str, op, opLen);
+  if (opIdx != std::string::npos)
+  {
+    std::unique_ptr<ValueNode> lhs = compileValue(str.substr(0, opIdx));
+    std::unique_ptr<ValueNode> rhs = compileValue(str.substr(opIdx + opLen));
+    if (lhs && rhs)
+    {
+      result = std::make_unique<ComparisonExpression>(op, std::move(lhs),
+          std::move(rhs));
+    }
+  }
+
+  // Attempt to compile the expression as a function.
+  if (!result)
+    result = compileFunction(str);
+
+  if (result)
+    result->text = str;
+  return result;
+}
+
+//////////////////////////////////////////////////
+const std::string &Expression::Text() const
+{
+  return this->text;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_EXPRESSION_HH_
+#define GZ_TEST_EXPRESSION_HH_
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <gz/sim/EntityComponentManager.hh>
+#include <gz/sim/System.hh>
+
+#include "gz/test/config.hh"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    class Test;
+
+    /// \brief A numeric operand of a compiled expression, such as a
+    /// literal, the simulation time, or an entity property.
+    class ValueNode
+    {
+      /// \brief Destructor.
+      public: virtual ~ValueNode() = default;
+
+      /// \brief Compute the value of this operand.
+      /// \param[in] _info Current simulation update information.
+      /// \param[in] _test The test that owns the expression.
+      /// \param[in] _ecm The entity component manager.
+      /// \return The value, or std::nullopt if it could not be computed.
+      public: virtual std::optional<double> Evaluate(
+                  const sim::UpdateInfo &_info, Test *_test,
+                  const sim::EntityComponentManager &_ecm) = 0;
+    };
+
+    /// \brief Base class for a boolean expression, such as the contents of
+    /// an "expect" or "assert" command. An expression is compiled once,
+    /// when the trigger is loaded, and then evaluated on every update
+    /// without any string processing.
+    class Expression
+    {
+      /// \brief Destructor.
+      public: virtual ~Expression() = default;
+
+      /// \brief Compile an expression string. The string may optionally be
+      /// wrapped in "${{" and "}}".
+      /// \param[in] _str The expression string.
+      /// \return The compiled expression, or nullptr if the string is not
+      /// a valid expression.
+      public: static std::unique_ptr<Expression> Compile(
+                  const std::string &_str);
+
+      /// \brief Evaluate the expression.
+      /// \param[in] _info Current simulation update information.
+      /// \param[in] _test The test that owns the expression.
+      /// \param[in] _ecm The entity component manager.
+      /// \return The result, or std::nullopt if the expression could not
+      /// be evaluated.
+      public: virtual std::optional<bool> Evaluate(
+                  const sim::UpdateInfo &_info, Test *_test,
+                  const sim::EntityComponentManager &_ecm) = 0;
+
+      /// \brief Get the source text of the expression, without the
+      /// surrounding "${{" and "}}".
+      /// \return The expression text.
+      public: const std::string &Text() const;
+
+      /// \brief The expression text.
+      private: std::string text;
+    };
+    }
+  }
+}
+#endif
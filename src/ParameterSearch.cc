@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include <gz/common/Console.hh>
+#include <gz/common/StringUtils.hh>
+
+#include "ParameterSearch.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+bool ParameterSearch::Load(const YAML::Node &_node,
+    const std::set<std::string> &_integers)
+{
+  if (_node["method"] &&
+      common::lowercase(_node["method"].as<std::string>()) != "bisection")
+  {
+    gzerr << "Unknown search method[" << _node["method"].as<std::string>()
+      << "]\n";
+    return false;
+  }
+
+  if (!_node["parameter"] || !_node["min"] || !_node["max"])
+  {
+    gzerr << "A search needs a parameter, a min and a max\n";
+    return false;
+  }
+
+  this->parameter = _node["parameter"].as<std::string>();
+  this->low = _node["min"].as<double>();
+  this->high = _node["max"].as<double>();
+  this->integer = _integers.count(this->parameter) > 0;
+  if (_node["tolerance"])
+    this->tolerance = _node["tolerance"].as<double>();
+  else
+    this->tolerance = (this->high - this->low) / 100.0;
+
+  if (this->high <= this->low)
+  {
+    gzerr << "Search parameter[" << this->parameter << "] has max <= min\n";
+    return false;
+  }
+  if (this->tolerance <= 0 && !this->integer)
+  {
+    gzerr << "Search tolerance must be positive\n";
+    return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+const std::string &ParameterSearch::Parameter() const
+{
+  return this->parameter;
+}
+
+/////////////////////////////////////////////////
+std::optional<std::string> ParameterSearch::Next()
+{
+  if (!this->lowPassed)
+    this->probe = this->low;
+  else if (!this->highPassed)
+    this->probe = this->high;
+  else
+  {
+    // Stop if there is no boundary, or it is located precisely enough.
+    if (*this->lowPassed == *this->highPassed ||
+        this->high - this->low <= this->tolerance)
+    {
+      return std::nullopt;
+    }
+
+    this->probe = 0.5 * (this->low + this->high);
+    if (this->integer)
+    {
+      this->probe = std::floor(this->probe);
+      if (this->probe <= this->low)
+        return std::nullopt;
+    }
+  }
+
+  this->probeCount++;
+  return this->Format(this->probe);
+}
+
+/////////////////////////////////////////////////
+void ParameterSearch::Report(bool _passed)
+{
+  if (!this->lowPassed)
+  {
+    this->lowPassed = _passed;
+  }
+  else if (!this->highPassed)
+  {
+    this->highPassed = _passed;
+  }
+  else if (_passed == *this->lowPassed)
+  {
+    this->low = this->probe;
+  }
+  else
+  {
+    this->high = this->probe;
+  }
+}
+
+/////////////////////////////////////////////////
+void ParameterSearch::FillResults(domain::ParameterSearch *_msg) const
+{
+  _msg->set_parameter(this->parameter);
+  _msg->set_probe_count(this->probeCount);
+
+  bool found = this->lowPassed && this->highPassed &&
+    *this->lowPassed != *this->highPassed;
+  _msg->set_found(found);
+  if (found)
+  {
+    _msg->set_pass_value(this->Format(
+          *this->lowPassed ? this->low : this->high));
+    _msg->set_fail_value(this->Format(
+          *this->lowPassed ? this->high : this->low));
+  }
+}
+
+/////////////////////////////////////////////////
+std::string ParameterSearch::Format(double _value) const
+{
+  if (this->integer)
+    return std::to_string(std::llround(_value));
+
+  std::ostringstream stream;
+  stream.precision(15);
+  stream << _value;
+  return stream.str();
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_PARAMETERSEARCH_HH_
+#define GZ_TEST_PARAMETERSEARCH_HH_
+
+#include <yaml-cpp/yaml.h>
+
+#include <optional>
+#include <set>
+#include <string>
+
+#include "gz/test/config.hh"
+#include "msgs/scenario.pb.h"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief Bisects a numeric parameter to find the value where a
+    /// scenario's tests switch between passing and failing, assuming the
+    /// outcome changes once over the range.
+    ///
+    /// Both ends of the range are probed first. If their outcomes differ,
+    /// the interval that contains the boundary is halved until it is no
+    /// wider than the tolerance, so that only about
+    /// log2((max - min) / tolerance) + 2 values are probed.
+    class ParameterSearch
+    {
+      /// \brief Load the search configuration.
+      /// \param[in] _node The YAML node of the search.
+      /// \param[in] _integers Names of the parameters that have integer
+      /// values.
+      /// \return True if the configuration is valid.
+      public: bool Load(const YAML::Node &_node,
+                  const std::set<std::string> &_integers);
+
+      /// \brief Get the name of the searched parameter.
+      /// \return The parameter name.
+      public: const std::string &Parameter() const;
+
+      /// \brief Get the next value to probe.
+      /// \return The value, or std::nullopt if the search is complete.
+      public: std::optional<std::string> Next();
+
+      /// \brief Report the outcome of the value returned by Next.
+      /// \param[in] _passed True if the iteration passed.
+      public: void Report(bool _passed);
+
+      /// \brief Fill in a message with the result of the search.
+      /// \param[in] _msg The message to populate.
+      public: void FillResults(domain::ParameterSearch *_msg) const;
+
+      /// \brief Format a value of the parameter.
+      /// \param[in] _value The value.
+      /// \return The formatted value.
+      private: std::string Format(double _value) const;
+
+      /// \brief Name of the searched parameter.
+      private: std::string parameter;
+
+      /// \brief Interval that contains the boundary.
+      private: double low{0};
+      private: double high{0};
+
+      /// \brief Width of the interval at which the search stops.
+      private: double tolerance{0};
+
+      /// \brief True if the parameter has integer values.
+      private: bool integer{false};
+
+      /// \brief Outcomes at the ends of the interval, once probed.
+      private: std::optional<bool> lowPassed;
+      private: std::optional<bool> highPassed;
+
+      /// \brief The value being probed.
+      private: double probe{0};
+
+      /// \brief Number of probed values.
+      private: int probeCount{0};
+    };
+    }
+  }
+}
+#endif
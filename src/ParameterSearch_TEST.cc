@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ParameterSearch.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+/// \brief Run a search until it is complete.
+/// \param[in] _search The search.
+/// \param[in] _passed Outcome of an iteration, by parameter value.
+/// \return The probed values, in order.
+static std::vector<std::string> run(ParameterSearch &_search,
+    const std::function<bool(double)> &_passed)
+{
+  std::vector<std::string> probes;
+  for (std::optional<std::string> value = _search.Next(); value;
+       value = _search.Next())
+  {
+    probes.push_back(*value);
+    _search.Report(_passed(std::stod(*value)));
+
+    // Guard against a search that never ends.
+    if (probes.size() > 1000u)
+      break;
+  }
+  return probes;
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSearch, Bisection)
+{
+  ParameterSearch search;
+  ASSERT_TRUE(search.Load(YAML::Load(
+        "{parameter: velocity, min: 0, max: 1, tolerance: 0.01}"), {}));
+  EXPECT_EQ("velocity", search.Parameter());
+
+  std::vector<std::string> probes =
+    run(search, [](double _v) {return _v < 0.3;});
+
+  // Both ends, then one probe per halving of the interval.
+  ASSERT_EQ(9u, probes.size());
+  EXPECT_EQ("0", probes[0]);
+  EXPECT_EQ("1", probes[1]);
+  EXPECT_EQ("0.5", probes[2]);
+  EXPECT_EQ("0.25", probes[3]);
+
+  domain::ParameterSearch msg;
+  search.FillResults(&msg);
+  EXPECT_EQ("velocity", msg.parameter());
+  EXPECT_TRUE(msg.found());
+  EXPECT_EQ(9, msg.probe_count());
+  double pass = std::stod(msg.pass_value());
+  double fail = std::stod(msg.fail_value());
+  EXPECT_LT(pass, 0.3);
+  EXPECT_GE(fail, 0.3);
+  EXPECT_LE(fail - pass, 0.01);
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSearch, FailingLowEnd)
+{
+  // The boundary is found whichever end passes.
+  ParameterSearch search;
+  ASSERT_TRUE(search.Load(YAML::Load(
+        "{parameter: mass, min: 10, max: 20, tolerance: 0.5}"), {}));
+  run(search, [](double _v) {return _v > 17.2;});
+
+  domain::ParameterSearch msg;
+  search.FillResults(&msg);
+  EXPECT_TRUE(msg.found());
+  double pass = std::stod(msg.pass_value());
+  double fail = std::stod(msg.fail_value());
+  EXPECT_GT(pass, 17.2);
+  EXPECT_LE(fail, 17.2);
+  EXPECT_LE(pass - fail, 0.5);
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSearch, IntegerBisectionStops)
+{
+  ParameterSearch search;
+  ASSERT_TRUE(search.Load(YAML::Load(
+        "{parameter: count, min: 0, max: 10, tolerance: 0}"), {"count"}));
+
+  // The interval can't be halved once its ends are adjacent integers.
+  std::vector<std::string> probes =
+    run(search, [](double _v) {return _v < 7;});
+  EXPECT_EQ((std::vector<std::string>{"0", "10", "5", "7", "6"}), probes);
+
+  domain::ParameterSearch msg;
+  search.FillResults(&msg);
+  EXPECT_TRUE(msg.found());
+  EXPECT_EQ("6", msg.pass_value());
+  EXPECT_EQ("7", msg.fail_value());
+  EXPECT_EQ(5, msg.probe_count());
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSearch, NoBoundary)
+{
+  ParameterSearch search;
+  ASSERT_TRUE(search.Load(YAML::Load(
+        "{parameter: velocity, min: 0, max: 1}"), {}));
+
+  // Both ends pass, so there is nothing to bisect.
+  EXPECT_EQ(2u, run(search, [](double) {return true;}).size());
+
+  domain::ParameterSearch msg;
+  search.FillResults(&msg);
+  EXPECT_FALSE(msg.found());
+  EXPECT_EQ(2, msg.probe_count());
+  EXPECT_TRUE(msg.pass_value().empty());
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSearch, InvalidSearches)
+{
+  EXPECT_FALSE(ParameterSearch().Load(YAML::Load(
+          "{method: golden, parameter: v, min: 0, max: 1}"), {}));
+  EXPECT_FALSE(ParameterSearch().Load(YAML::Load(
+          "{parameter: v, min: 0}"), {}));
+  EXPECT_FALSE(ParameterSearch().Load(YAML::Load(
+          "{parameter: v, min: 1, max: 1}"), {}));
+  EXPECT_FALSE(ParameterSearch().Load(YAML::Load(
+          "{parameter: v, min: 0, max: 1, tolerance: 0}"), {}));
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+
+#include <gz/common/Console.hh>
+#include <gz/common/StringUtils.hh>
+
+#include "ParameterSweep.hh"
+
+using namespace gz;
+using namespace test;
+
+namespace
+{
+  //////////////////////////////////////////////////
+  /// \brief Mix the bits of a value, using the splitmix64 finalizer.
+  uint64_t mix(uint64_t _x)
+  {
+    _x ^= _x >> 30;
+    _x *= 0xbf58476d1ce4e5b9ULL;
+    _x ^= _x >> 27;
+    _x *= 0x94d049bb133111ebULL;
+    _x ^= _x >> 31;
+    return _x;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Apply a keyed pseudo-random permutation of [0, _n) to a value.
+  /// The permutation is a balanced Feistel network over the smallest power
+  /// of four that covers _n, and values that land outside of the range
+  /// are encrypted again until they are inside it (cycle walking).
+  /// \param[in] _i The value, less than _n.
+  /// \param[in] _n Size of the range.
+  /// \param[in] _key Key of the permutation.
+  /// \return The permuted value.
+  uint64_t permute(uint64_t _i, uint64_t _n, uint64_t _key)
+  {
+    unsigned int halfBits = 1;
+    while (halfBits < 32 && (uint64_t(1) << (2 * halfBits)) < _n)
+      ++halfBits;
+    const uint64_t mask = (uint64_t(1) << halfBits) - 1;
+
+    do
+    {
+      uint64_t left = _i >> halfBits;
+      uint64_t right = _i & mask;
+      for (uint64_t round = 0; round < 6; ++round)
+      {
+        uint64_t next = left ^ (mix(right ^ mix(_key + round)) & mask);
+        left = right;
+        right = next;
+      }
+      _i = (left << halfBits) | right;
+    } while (_i >= _n);
+    return _i;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Create a random engine for a seed and a stream index, so that
+  /// every iteration and dimension draws from its own sequence.
+  std::mt19937_64 makeEngine(uint64_t _seed, uint64_t _stream)
+  {
+    std::seed_seq seq{
+      static_cast<uint32_t>(_seed), static_cast<uint32_t>(_seed >> 32),
+      static_cast<uint32_t>(_stream), static_cast<uint32_t>(_stream >> 32)};
+    return std::mt19937_64(seq);
+  }
+}
+
+/////////////////////////////////////////////////
+bool ParameterSweep::Load(const YAML::Node &_node,
+    const std::set<std::string> &_integers)
+{
+  std::string typeStr = _node["type"] ?
+    common::lowercase(_node["type"].as<std::string>()) : "grid";
+  if (typeStr == "grid")
+    this->type = Type::GRID;
+  else if (typeStr == "random")
+    this->type = Type::RANDOM;
+  else if (typeStr == "latin-hypercube")
+    this->type = Type::LATIN_HYPERCUBE;
+  else
+  {
+    gzerr << "Unknown sweep type[" << typeStr << "]\n";
+    return false;
+  }
+
+  if (this->Random())
+  {
+    if (_node["samples"])
+      this->samples = _node["samples"].as<uint64_t>();
+    if (this->samples == 0)
+    {
+      gzerr << "A " << typeStr << " sweep needs a positive sample count\n";
+      return false;
+    }
+
+    if (_node["seed"])
+    {
+      this->seed = _node["seed"].as<uint64_t>();
+    }
+    else
+    {
+      std::random_device device;
+      this->seed = (static_cast<uint64_t>(device()) << 32) | device();
+    }
+  }
+
+  if (!_node["parameters"] || !_node["parameters"].IsMap())
+  {
+    gzerr << "A sweep needs a map of parameters\n";
+    return false;
+  }
+
+  for (YAML::const_iterator it = _node["parameters"].begin();
+       it != _node["parameters"].end(); ++it)
+  {
+    Dimension dim;
+    dim.name = it->first.as<std::string>();
+    dim.integer = _integers.count(dim.name) > 0;
+    YAML::Node paramNode = it->second;
+
+    // A parameter is either a list of values, or a range.
+    YAML::Node valuesNode = paramNode.IsSequence() ? paramNode :
+      paramNode["values"];
+    if (valuesNode && valuesNode.IsSequence())
+    {
+      for (YAML::const_iterator valueIt = valuesNode.begin();
+           valueIt != valuesNode.end(); ++valueIt)
+      {
+        dim.values.push_back(valueIt->as<std::string>());
+      }
+      if (dim.values.empty())
+      {
+        gzerr << "Sweep parameter[" << dim.name << "] has no values\n";
+        return false;
+      }
+      dim.count = dim.values.size();
+    }
+    else if (paramNode["distribution"] &&
+        common::lowercase(paramNode["distribution"].as<std::string>()) ==
+        "normal")
+    {
+      // Strata need a bounded range, and grid values are evenly spaced.
+      if (this->type != Type::RANDOM)
+      {
+        gzerr << "Sweep parameter[" << dim.name << "] has a normal "
+          << "distribution, which only random sweeps support\n";
+        return false;
+      }
+      dim.normal = true;
+      dim.mean = paramNode["mean"] ? paramNode["mean"].as<double>() : 0.0;
+      dim.stddev = paramNode["stddev"] ?
+        paramNode["stddev"].as<double>() : 1.0;
+    }
+    else if (paramNode["min"] && paramNode["max"])
+    {
+      dim.min = paramNode["min"].as<double>();
+      dim.max = paramNode["max"].as<double>();
+      if (dim.max < dim.min)
+      {
+        gzerr << "Sweep parameter[" << dim.name << "] has max < min\n";
+        return false;
+      }
+
+      if (this->type == Type::GRID)
+      {
+        if (paramNode["count"])
+        {
+          dim.count = paramNode["count"].as<uint64_t>();
+          if (dim.count == 0)
+          {
+            gzerr << "Sweep parameter[" << dim.name
+              << "] needs a positive count\n";
+            return false;
+          }
+          dim.step = dim.count > 1 ?
+            (dim.max - dim.min) / static_cast<double>(dim.count - 1) : 0.0;
+        }
+        else if (paramNode["step"] && paramNode["step"].as<double>() > 0)
+        {
+          dim.step = paramNode["step"].as<double>();
+          dim.count = static_cast<uint64_t>(
+              std::floor((dim.max - dim.min) / dim.step + 1e-9)) + 1;
+        }
+        else
+        {
+          gzerr << "Sweep parameter[" << dim.name
+            << "] needs a positive step or count\n";
+          return false;
+        }
+      }
+    }
+    else
+    {
+      gzerr << "Sweep parameter[" << dim.name
+        << "] needs values, or a min and max\n";
+      return false;
+    }
+
+    if (paramNode.IsMap() && paramNode["type"])
+    {
+      std::string paramType =
+        common::lowercase(paramNode["type"].as<std::string>());
+      dim.integer = paramType == "int" || paramType == "integer";
+    }
+
+    // Random integers are drawn from the integers in the range.
+    if (this->type == Type::RANDOM && dim.integer && dim.values.empty() &&
+        !dim.normal && std::ceil(dim.min) > std::floor(dim.max))
+    {
+      gzerr << "Sweep parameter[" << dim.name
+        << "] has no integer between min and max\n";
+      return false;
+    }
+
+    // Each dimension of a Latin hypercube visits its strata in the order
+    // of its own keyed pseudo-random permutation, which needs no memory
+    // and keeps the dimensions independent of each other.
+    if (this->type == Type::LATIN_HYPERCUBE)
+      dim.permKey = makeEngine(this->seed, this->dims.size())();
+
+    this->dims.push_back(dim);
+  }
+
+  if (this->dims.empty())
+  {
+    gzerr << "A sweep needs at least one parameter\n";
+    return false;
+  }
+
+  if (this->type == Type::GRID)
+  {
+    this->samples = 1;
+    for (const Dimension &dim : this->dims)
+    {
+      if (this->samples > std::numeric_limits<uint64_t>::max() / dim.count)
+      {
+        gzerr << "Too many grid points in sweep\n";
+        return false;
+      }
+      this->samples *= dim.count;
+    }
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+uint64_t ParameterSweep::Count() const
+{
+  return this->samples;
+}
+
+/////////////////////////////////////////////////
+uint64_t ParameterSweep::Seed() const
+{
+  return this->seed;
+}
+
+/////////////////////////////////////////////////
+bool ParameterSweep::Random() const
+{
+  return this->type != Type::GRID;
+}
+
+/////////////////////////////////////////////////
+std::vector<std::pair<std::string, std::string>> ParameterSweep::Values(
+    uint64_t _index) const
+{
+  std::vector<std::pair<std::string, std::string>> result;
+  result.reserve(this->dims.size());
+
+  switch (this->type)
+  {
+    case Type::GRID:
+    {
+      // The index is a mixed radix number, with the last parameter
+      // varying fastest.
+      std::vector<uint64_t> digits(this->dims.size());
+      for (size_t d = this->dims.size(); d-- > 0;)
+      {
+        digits[d] = _index % this->dims[d].count;
+        _index /= this->dims[d].count;
+      }
+      for (size_t d = 0; d < this->dims.size(); ++d)
+      {
+        const Dimension &dim = this->dims[d];
+        result.push_back({dim.name, dim.values.empty() ?
+            Format(dim, dim.min + static_cast<double>(digits[d]) * dim.step) :
+            dim.values[digits[d]]});
+      }
+      break;
+    }
+    case Type::RANDOM:
+    {
+      std::mt19937_64 engine = makeEngine(this->seed, _index);
+      for (const Dimension &dim : this->dims)
+      {
+        std::string value;
+        if (!dim.values.empty())
+        {
+          value = dim.values[std::uniform_int_distribution<size_t>(
+              0, dim.values.size() - 1)(engine)];
+        }
+        else if (dim.normal)
+        {
+          value = Format(dim,
+              std::normal_distribution<double>(dim.mean, dim.stddev)(engine));
+        }
+        else if (dim.integer)
+        {
+          value = std::to_string(std::uniform_int_distribution<int64_t>(
+                static_cast<int64_t>(std::ceil(dim.min)),
+                static_cast<int64_t>(std::floor(dim.max)))(engine));
+        }
+        else
+        {
+          value = Format(dim, std::uniform_real_distribution<double>(
+                dim.min, dim.max)(engine));
+        }
+        result.push_back({dim.name, value});
+      }
+      break;
+    }
+    case Type::LATIN_HYPERCUBE:
+    {
+      std::mt19937_64 engine = makeEngine(this->seed, _index);
+      std::uniform_real_distribution<double> jitter(0.0, 1.0);
+      for (const Dimension &dim : this->dims)
+      {
+        uint64_t stratum = permute(_index, this->samples, dim.permKey);
+        double u = (static_cast<double>(stratum) + jitter(engine)) /
+          static_cast<double>(this->samples);
+
+        if (!dim.values.empty())
+        {
+          size_t i = std::min(dim.values.size() - 1,
+              static_cast<size_t>(u * static_cast<double>(dim.values.size())));
+          result.push_back({dim.name, dim.values[i]});
+        }
+        else
+        {
+          result.push_back({dim.name,
+              Format(dim, dim.min + u * (dim.max - dim.min))});
+        }
+      }
+      break;
+    }
+  }
+
+  return result;
+}
+
+/////////////////////////////////////////////////
+std::string ParameterSweep::Format(const Dimension &_dim, double _value)
+{
+  if (_dim.integer)
+    return std::to_string(std::llround(_value));
+
+  std::ostringstream stream;
+  stream.precision(15);
+  stream << _value;
+  return stream.str();
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_PARAMETERSWEEP_HH_
+#define GZ_TEST_PARAMETERSWEEP_HH_
+
+#include <yaml-cpp/yaml.h>
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gz/test/config.hh"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief Generates the parameter values of the iterations of a
+    /// scenario from a declarative description, instead of an explicit
+    /// list. Iterations are computed on demand from their index, so that
+    /// a sweep never needs to be held in memory.
+    ///
+    /// Three kinds of sweep are supported:
+    ///   * grid: The cartesian product of the values of each parameter.
+    ///     Each parameter has a list of values, or a range with min, max,
+    ///     and either a step or a count.
+    ///   * random: A number of samples, where each parameter is drawn from
+    ///     a uniform distribution between min and max, a normal
+    ///     distribution with a mean and stddev, or a list of values.
+    ///   * latin-hypercube: A number of samples, where the range of each
+    ///     parameter between min and max is split into as many strata as
+    ///     there are samples, and each stratum is sampled exactly once.
+    ///
+    /// Random and Latin hypercube sweeps are reproducible from their seed,
+    /// which is generated if the sweep doesn't specify one.
+    class ParameterSweep
+    {
+      /// \brief Load a sweep description.
+      /// \param[in] _node The YAML node of the sweep.
+      /// \param[in] _integers Names of the parameters that have integer
+      /// values.
+      /// \return True if the sweep is valid.
+      public: bool Load(const YAML::Node &_node,
+                  const std::set<std::string> &_integers);
+
+      /// \brief Get the number of iterations of the sweep.
+      /// \return The number of iterations.
+      public: uint64_t Count() const;
+
+      /// \brief Get the seed of the sweep.
+      /// \return The seed.
+      public: uint64_t Seed() const;
+
+      /// \brief Get whether the sweep is random, and so depends on its
+      /// seed.
+      /// \return True for random and Latin hypercube sweeps.
+      public: bool Random() const;
+
+      /// \brief Compute the parameter values of an iteration.
+      /// \param[in] _index Index of the iteration, less than Count.
+      /// \return Pairs of parameter name and value.
+      public: std::vector<std::pair<std::string, std::string>> Values(
+                  uint64_t _index) const;
+
+      /// \brief The kinds of sweep.
+      private: enum class Type
+               {
+                 GRID,
+                 RANDOM,
+                 LATIN_HYPERCUBE
+               };
+
+      /// \brief A swept parameter.
+      private: class Dimension
+               {
+                 /// \brief Name of the parameter.
+                 public: std::string name;
+
+                 /// \brief Explicit values, if any.
+                 public: std::vector<std::string> values;
+
+                 /// \brief Range of the values.
+                 public: double min{0};
+                 public: double max{0};
+
+                 /// \brief Number of grid values.
+                 public: uint64_t count{1};
+
+                 /// \brief Distance between grid values.
+                 public: double step{0};
+
+                 /// \brief True to draw from a normal distribution.
+                 public: bool normal{false};
+
+                 /// \brief Parameters of the normal distribution.
+                 public: double mean{0};
+                 public: double stddev{1};
+
+                 /// \brief True if the values are integers.
+                 public: bool integer{false};
+
+                 /// \brief Key of the pseudo-random permutation of the
+                 /// Latin hypercube strata.
+                 public: uint64_t permKey{0};
+               };
+
+      /// \brief Format a value of a dimension.
+      /// \param[in] _dim The dimension.
+      /// \param[in] _value The value.
+      /// \return The formatted value.
+      private: static std::string Format(const Dimension &_dim,
+                   double _value);
+
+      /// \brief Kind of sweep.
+      private: Type type{Type::GRID};
+
+      /// \brief Number of samples of a random sweep.
+      private: uint64_t samples{0};
+
+      /// \brief Seed of a random sweep.
+      private: uint64_t seed{0};
+
+      /// \brief The swept parameters.
+      private: std::vector<Dimension> dims;
+    };
+    }
+  }
+}
+#endif
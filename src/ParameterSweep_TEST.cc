@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ParameterSweep.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+/// \brief Get the values of an iteration, without their names.
+/// \param[in] _sweep The sweep.
+/// \param[in] _index Index of the iteration.
+/// \return The values, in the order of the sweep's parameters.
+static std::vector<std::string> values(const ParameterSweep &_sweep,
+    uint64_t _index)
+{
+  std::vector<std::string> result;
+  for (const std::pair<std::string, std::string> &value :
+      _sweep.Values(_index))
+  {
+    result.push_back(value.second);
+  }
+  return result;
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, GridIndexIsMixedRadix)
+{
+  ParameterSweep sweep;
+  ASSERT_TRUE(sweep.Load(YAML::Load(
+        "{parameters: {a: [x, y], b: {min: 0, max: 1, count: 3},"
+        " c: {values: [p, q, r, s]}}}"), {}));
+  EXPECT_FALSE(sweep.Random());
+  ASSERT_EQ(24u, sweep.Count());
+
+  // The last parameter varies fastest.
+  EXPECT_EQ((std::vector<std::string>{"x", "0", "p"}), values(sweep, 0));
+  EXPECT_EQ((std::vector<std::string>{"x", "0", "q"}), values(sweep, 1));
+  EXPECT_EQ((std::vector<std::string>{"x", "0.5", "p"}), values(sweep, 4));
+  EXPECT_EQ((std::vector<std::string>{"y", "0", "p"}), values(sweep, 12));
+  EXPECT_EQ((std::vector<std::string>{"y", "1", "s"}), values(sweep, 23));
+
+  // Each point of the grid is visited exactly once.
+  std::set<std::vector<std::string>> points;
+  for (uint64_t i = 0; i < sweep.Count(); ++i)
+    points.insert(values(sweep, i));
+  EXPECT_EQ(24u, points.size());
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, GridStep)
+{
+  ParameterSweep sweep;
+  ASSERT_TRUE(sweep.Load(YAML::Load(
+        "{parameters: {v: {min: 0.1, max: 1.0, step: 0.1}}}"), {}));
+  ASSERT_EQ(10u, sweep.Count());
+  EXPECT_NEAR(1.0, std::stod(values(sweep, 9)[0]), 1e-12);
+
+  // Integer parameters are rounded.
+  ParameterSweep integers;
+  ASSERT_TRUE(integers.Load(YAML::Load(
+        "{parameters: {n: {min: 1, max: 10, count: 4}}}"), {"n"}));
+  EXPECT_EQ((std::vector<std::string>{"4"}), values(integers, 1));
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, GridTooLarge)
+{
+  ParameterSweep sweep;
+  EXPECT_FALSE(sweep.Load(YAML::Load(
+        "{parameters: {a: {min: 0, max: 1, count: 4294967296},"
+        " b: {min: 0, max: 1, count: 4294967296}}}"), {}));
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, RandomIsReproducible)
+{
+  const std::string yaml = "{type: random, samples: 50, seed: 1234,"
+    " parameters: {u: {min: -1, max: 1}, n: {min: 1, max: 3},"
+    " g: {distribution: normal, mean: 5, stddev: 0.1}}}";
+  ParameterSweep first;
+  ParameterSweep second;
+  ASSERT_TRUE(first.Load(YAML::Load(yaml), {"n"}));
+  ASSERT_TRUE(second.Load(YAML::Load(yaml), {"n"}));
+  EXPECT_TRUE(first.Random());
+  EXPECT_EQ(1234u, first.Seed());
+  ASSERT_EQ(50u, first.Count());
+
+  for (uint64_t i = 0; i < first.Count(); ++i)
+  {
+    std::vector<std::string> v = values(first, i);
+    EXPECT_EQ(v, values(second, i));
+    ASSERT_EQ(3u, v.size());
+    EXPECT_LE(-1.0, std::stod(v[0]));
+    EXPECT_GE(1.0, std::stod(v[0]));
+    EXPECT_TRUE(v[1] == "1" || v[1] == "2" || v[1] == "3") << v[1];
+    EXPECT_NEAR(5.0, std::stod(v[2]), 1.0);
+  }
+
+  // Iterations are computed from their index, in any order.
+  EXPECT_EQ(values(first, 7), values(second, 7));
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, LatinHypercubeCoversEachStratumOnce)
+{
+  // Sample counts that are, and aren't, powers of four exercise the
+  // cycle walking of the strata permutation.
+  for (uint64_t samples : {1u, 2u, 3u, 4u, 5u, 16u, 17u, 100u, 1000u})
+  {
+    ParameterSweep sweep;
+    ASSERT_TRUE(sweep.Load(YAML::Load(
+          "{type: latin-hypercube, samples: " + std::to_string(samples) +
+          ", seed: 42, parameters: {a: {min: 0, max: 1},"
+          " b: {min: 10, max: 20}}}"), {}));
+    ASSERT_EQ(samples, sweep.Count());
+
+    std::vector<int> aStrata(samples, 0);
+    std::vector<int> bStrata(samples, 0);
+    bool sameOrder = true;
+    for (uint64_t i = 0; i < samples; ++i)
+    {
+      std::vector<std::string> v = values(sweep, i);
+      ASSERT_EQ(2u, v.size());
+      uint64_t a = static_cast<uint64_t>(
+          std::stod(v[0]) * static_cast<double>(samples));
+      uint64_t b = static_cast<uint64_t>(
+          (std::stod(v[1]) - 10.0) / 10.0 * static_cast<double>(samples));
+      ASSERT_LT(a, samples);
+      ASSERT_LT(b, samples);
+      ++aStrata[a];
+      ++bStrata[b];
+      sameOrder = sameOrder && a == b;
+    }
+
+    for (uint64_t s = 0; s < samples; ++s)
+    {
+      EXPECT_EQ(1, aStrata[s]) << "samples " << samples << " stratum " << s;
+      EXPECT_EQ(1, bStrata[s]) << "samples " << samples << " stratum " << s;
+    }
+
+    // Each dimension has its own permutation.
+    if (samples >= 16)
+    {
+      EXPECT_FALSE(sameOrder) << "samples " << samples;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, NormalOnlyForRandom)
+{
+  ParameterSweep latin;
+  EXPECT_FALSE(latin.Load(YAML::Load(
+        "{type: latin-hypercube, samples: 10, parameters:"
+        " {g: {distribution: normal, min: 0, max: 1}}}"), {}));
+
+  ParameterSweep grid;
+  EXPECT_FALSE(grid.Load(YAML::Load(
+        "{parameters: {g: {distribution: normal, min: 0, max: 1,"
+        " count: 2}}}"), {}));
+}
+
+/////////////////////////////////////////////////
+TEST(ParameterSweep, InvalidSweeps)
+{
+  EXPECT_FALSE(ParameterSweep().Load(YAML::Load(
+          "{type: spiral, parameters: {a: [1]}}"), {}));
+  EXPECT_FALSE(ParameterSweep().Load(YAML::Load(
+          "{type: random, parameters: {a: [1]}}"), {}));
+  EXPECT_FALSE(ParameterSweep().Load(YAML::Load("{parameters: {}}"), {}));
+  EXPECT_FALSE(ParameterSweep().Load(YAML::Load(
+          "{parameters: {a: {min: 2, max: 1, count: 2}}}"), {}));
+  EXPECT_FALSE(ParameterSweep().Load(YAML::Load(
+          "{parameters: {a: {min: 0, max: 1}}}"), {}));
+  EXPECT_FALSE(ParameterSweep().Load(YAML::Load(
+          "{type: random, samples: 3, parameters:"
+          " {n: {min: 1.2, max: 1.8}}}"), {"n"}));
+}
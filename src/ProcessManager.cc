@@ -15,9 +15,16 @@
  *
 */
 #include <csignal> // NOLINT(*)
+#include <cerrno>
 #include <fcntl.h>
+#ifdef __linux__
+  #include <sys/epoll.h>
+  #include <sys/syscall.h>
+#endif
 #ifndef _WIN32
   #include <semaphore.h>
+  #include <spawn.h>
+  #include <sys/resource.h>
   #include <sys/stat.h>
   #include <sys/wait.h>
   #include <unistd.h>
@@ -33,8 +40,11 @@
 #include <signal.h>
 
 #include <filesystem>
+#include <fstream>
 #include <condition_variable>
+#include <cstring>
 #include <ctime>
+#include <functional>
 #include <limits>
 #include <list>
 #include <mutex>
@@ -43,13 +53,13 @@
 #include <random>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <gz/common/Console.hh>
 #include <gz/common/Filesystem.hh>
-#include <gz/common/TempDirectory.hh>
 
 #include "ProcessManager.hh"
 #include "vendor/backward.hpp"
@@ -57,6 +67,10 @@
 using namespace gz::test;
 using namespace std::chrono_literals;
 
+#ifndef _WIN32
+extern char **environ;
+#endif
+
 #ifdef _WIN32
 // Returns the last Win32 error, in string format. Returns an empty string if
 // there is no error.
@@ -142,7 +156,322 @@ class Executable
 
   /// \brief Environment variables.
   public: std::list<std::string> envs;
+
+  /// \brief True until the process has been reaped.
+  public: bool running = true;
+
+  /// \brief Exit code of the process, or 128 plus the signal number if
+  /// the process was killed by a signal. Valid once running is false.
+  public: int exitCode = -1;
+
+  /// \brief True if the process exit is reported by the event loop. When
+  /// false, processes are polled while waiting for them.
+  public: bool watched = false;
+
+  /// \brief True if the process was signaled by Stop.
+  public: bool stopped = false;
+};
+
+/// \brief A thread, shared by all process managers, that runs queued
+/// launches, so that callers never block on the filesystem or on fork.
+class LaunchQueue
+{
+  /// \brief Get the launch queue.
+  /// \return The launch queue.
+  public: static LaunchQueue &Instance()
+          {
+            static LaunchQueue queue;
+            return queue;
+          }
+
+  /// \brief Destructor. Runs the remaining launches, and stops the thread.
+  public: ~LaunchQueue()
+          {
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              this->quit = true;
+            }
+            this->cv.notify_all();
+            if (this->thread.joinable())
+              this->thread.join();
+          }
+
+  /// \brief Queue a launch. The thread is started on first use.
+  /// \param[in] _job The launch to run.
+  public: void Push(std::function<void()> _job)
+          {
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              if (!this->thread.joinable())
+                this->thread = std::thread(&LaunchQueue::Run, this);
+              this->jobs.push(std::move(_job));
+            }
+            this->cv.notify_one();
+          }
+
+  /// \brief Run queued launches until quit.
+  private: void Run()
+           {
+             while (true)
+             {
+               std::function<void()> job;
+               {
+                 std::unique_lock<std::mutex> lock(this->mutex);
+                 this->cv.wait(lock, [this]
+                     {
+                       return this->quit || !this->jobs.empty();
+                     });
+                 if (this->jobs.empty())
+                   return;
+                 job = std::move(this->jobs.front());
+                 this->jobs.pop();
+               }
+               job();
+             }
+           }
+
+  /// \brief The queued launches.
+  private: std::queue<std::function<void()>> jobs;
+
+  /// \brief Mutex to protect the jobs and quit flag.
+  private: std::mutex mutex;
+
+  /// \brief Signaled when a launch is queued, or on quit.
+  private: std::condition_variable cv;
+
+  /// \brief True to stop the thread.
+  private: bool quit{false};
+
+  /// \brief The launcher thread.
+  private: std::thread thread;
+};
+
+#ifdef __linux__
+/// \brief A log file that is rotated when it reaches a maximum size. The
+/// log is written to _filename, and older content is moved to
+/// _filename.1, _filename.2, and so on.
+class RotatingLog
+{
+  /// \brief Constructor.
+  /// \param[in] _filename Path to the log file.
+  /// \param[in] _maxSize Maximum size of a log file, in bytes.
+  /// \param[in] _maxFiles Maximum number of log files, including
+  /// _filename.
+  public: RotatingLog(const std::string &_filename, size_t _maxSize,
+              unsigned int _maxFiles)
+          : filename(_filename), maxSize(_maxSize),
+            maxFiles(std::max(_maxFiles, 1u))
+          {
+          }
+
+  /// \brief Append data to the log.
+  /// \param[in] _data The data.
+  /// \param[in] _size Size of the data.
+  public: void Write(const char *_data, size_t _size)
+          {
+            while (_size > 0)
+            {
+              if (!this->stream.is_open() || this->size >= this->maxSize)
+                this->Open();
+
+              size_t count = std::min(_size, this->maxSize - this->size);
+              this->stream.write(_data, count);
+              this->size += count;
+              _data += count;
+              _size -= count;
+            }
+            this->stream.flush();
+          }
+
+  /// \brief Open the log file, rotating the existing files if the current
+  /// file is full.
+  private: void Open()
+           {
+             if (this->stream.is_open())
+             {
+               this->stream.close();
+               std::error_code ec;
+               for (unsigned int i = this->maxFiles - 1; i > 0; --i)
+               {
+                 std::string from = i == 1 ? this->filename :
+                   this->filename + "." + std::to_string(i - 1);
+                 std::filesystem::rename(from,
+                     this->filename + "." + std::to_string(i), ec);
+               }
+               if (this->maxFiles == 1)
+                 std::filesystem::remove(this->filename, ec);
+             }
+             this->stream.open(this->filename,
+                 std::ios::out | std::ios::binary | std::ios::trunc);
+             this->size = 0;
+           }
+
+  /// \brief Path to the log file.
+  private: std::string filename;
+
+  /// \brief Maximum size of a log file, in bytes.
+  private: size_t maxSize;
+
+  /// \brief Maximum number of log files.
+  private: unsigned int maxFiles;
+
+  /// \brief The current log file.
+  private: std::ofstream stream;
+
+  /// \brief Size of the current log file.
+  private: size_t size{0};
+};
+
+/// \brief A thread, shared by all process managers, that waits on file
+/// descriptors with epoll, and runs a callback when one is readable.
+class EventLoop
+{
+  /// \brief Callback run when a file descriptor is readable.
+  /// \return False to stop watching, and close, the file descriptor.
+  public: using Callback = std::function<bool(int)>;
+
+  /// \brief Get the event loop.
+  /// \return The event loop.
+  public: static EventLoop &Instance()
+          {
+            static EventLoop loop;
+            return loop;
+          }
+
+  /// \brief Constructor.
+  public: EventLoop()
+          {
+            this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (this->epollFd < 0 || pipe2(this->wakeFds, O_CLOEXEC) != 0)
+            {
+              gzerr << "Unable to create the process event loop: "
+                << std::strerror(errno) << "\n";
+              return;
+            }
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = this->wakeFds[0];
+            epoll_ctl(this->epollFd, EPOLL_CTL_ADD, this->wakeFds[0], &event);
+            this->thread = std::thread(&EventLoop::Run, this);
+          }
+
+  /// \brief Destructor. Stops the thread.
+  public: ~EventLoop()
+          {
+            if (this->thread.joinable())
+            {
+              char c = 0;
+              while (write(this->wakeFds[1], &c, 1) < 0 && errno == EINTR)
+                continue;
+              this->thread.join();
+            }
+            for (auto &[fd, cb] : this->callbacks)
+              close(fd);
+            if (this->epollFd >= 0)
+              close(this->epollFd);
+            if (this->wakeFds[0] >= 0)
+            {
+              close(this->wakeFds[0]);
+              close(this->wakeFds[1]);
+            }
+          }
+
+  /// \brief Watch a file descriptor. The event loop takes ownership of
+  /// the file descriptor.
+  /// \param[in] _fd The file descriptor.
+  /// \param[in] _cb Run on the event loop thread when _fd is readable.
+  /// \return True if the file descriptor is watched.
+  public: bool Add(int _fd, Callback _cb)
+          {
+            if (!this->thread.joinable())
+            {
+              close(_fd);
+              return false;
+            }
+
+            {
+              std::lock_guard<std::mutex> lock(this->mutex);
+              this->callbacks[_fd] =
+                std::make_shared<Callback>(std::move(_cb));
+            }
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = _fd;
+            if (epoll_ctl(this->epollFd, EPOLL_CTL_ADD, _fd, &event) != 0)
+            {
+              gzerr << "Unable to watch file descriptor: "
+                << std::strerror(errno) << "\n";
+              this->Remove(_fd);
+              return false;
+            }
+            return true;
+          }
+
+  /// \brief Stop watching, and close, a file descriptor.
+  /// \param[in] _fd The file descriptor.
+  private: void Remove(int _fd)
+           {
+             epoll_ctl(this->epollFd, EPOLL_CTL_DEL, _fd, nullptr);
+             std::lock_guard<std::mutex> lock(this->mutex);
+             this->callbacks.erase(_fd);
+             close(_fd);
+           }
+
+  /// \brief Wait for events until the wake pipe is written.
+  private: void Run()
+           {
+             const int maxEvents = 64;
+             epoll_event events[maxEvents];
+             while (true)
+             {
+               int count = epoll_wait(this->epollFd, events, maxEvents, -1);
+               if (count < 0)
+               {
+                 if (errno == EINTR)
+                   continue;
+                 gzerr << "epoll_wait failed: " << std::strerror(errno)
+                   << "\n";
+                 return;
+               }
+
+               for (int i = 0; i < count; ++i)
+               {
+                 int fd = events[i].data.fd;
+                 if (fd == this->wakeFds[0])
+                   return;
+
+                 std::shared_ptr<Callback> cb;
+                 {
+                   std::lock_guard<std::mutex> lock(this->mutex);
+                   auto iter = this->callbacks.find(fd);
+                   if (iter != this->callbacks.end())
+                     cb = iter->second;
+                 }
+
+                 if (cb && !(*cb)(fd))
+                   this->Remove(fd);
+               }
+             }
+           }
+
+  /// \brief The epoll file descriptor.
+  private: int epollFd{-1};
+
+  /// \brief Pipe used to stop the thread.
+  private: int wakeFds[2]{-1, -1};
+
+  /// \brief Callbacks, by file descriptor.
+  private: std::unordered_map<int, std::shared_ptr<Callback>> callbacks;
+
+  /// \brief Mutex to protect the callbacks.
+  private: std::mutex mutex;
+
+  /// \brief The event loop thread.
+  private: std::thread thread;
 };
+#endif
 
 /// \brief Private data variables for the Gazebo class.
 class gz::test::ProcessManagerPrivate
@@ -150,19 +479,36 @@ class gz::test::ProcessManagerPrivate
   /// \brief Constructor.
   public: ProcessManagerPrivate();
 
-  /// \brief Handle SIG_CHILD
-  /// \param[in] _sig The signal
-  public: static void OnSigChild(int _sig);
+  /// \brief Destructor.
+  public: ~ProcessManagerPrivate();
 
   /// \brief Set environment variables.
   /// \param[in] _envs List of environment variable name,value pairs.
   public: void SetEnvs(const std::list<std::string> &_envs);
 
-  /// \brief A list of children that were stopped
 #ifndef _WIN32
-  public: std::queue<pid_t> stoppedChildren;
+  /// \brief Launch a command with posix_spawn, in its own process group.
+  /// \param[in] _cmd The command and its arguments.
+  /// \param[in] _envs Environment variables to set, in addition to the
+  /// environment of this process.
+  /// \param[in] _outFd File descriptor to use as stdout, or -1 to
+  /// inherit stdout.
+  /// \param[in] _errFd File descriptor to use as stderr, or -1 to
+  /// inherit stderr.
+  /// \param[out] _pid Process id of the new process.
+  /// \return Zero on success, or an error number.
+  public: int Spawn(const std::vector<std::string> &_cmd,
+              const std::list<std::string> &_envs, int _outFd, int _errFd,
+              pid_t &_pid);
+#endif
+
+  /// \brief How executables are launched.
+#ifdef __linux__
+  public: ProcessManager::LaunchMethod method{
+            ProcessManager::LaunchMethod::SPAWN};
 #else
-  public: std::queue<HANDLE> stoppedChildren;
+  public: ProcessManager::LaunchMethod method{
+            ProcessManager::LaunchMethod::FORK};
 #endif
 
   /// \brief A list of executables that are running, or have been run.
@@ -171,6 +517,45 @@ class gz::test::ProcessManagerPrivate
   /// \brief Mutex to protect the executables list.
   public: std::mutex executablesMutex;
 
+  /// \brief Signaled when executables are reaped.
+  public: std::condition_variable exitCv;
+
+  /// \brief Exit status and resource usage of the reaped executables.
+  public: ProcessManager::Stats stats;
+
+  /// \brief Time given to executables to exit after SIGINT, and after
+  /// SIGTERM, before escalating.
+  public: std::chrono::steady_clock::duration interruptTimeout{5s};
+  public: std::chrono::steady_clock::duration terminateTimeout{5s};
+
+  /// \brief Handle used by the event loop to reach this object, which
+  /// may be destroyed before the event loop reports an exit.
+  public: class ReaperHandle
+          {
+            /// \brief Mutex to protect owner.
+            public: std::mutex mutex;
+
+            /// \brief The owner, or nullptr once it is destroyed.
+            public: ProcessManagerPrivate *owner{nullptr};
+          };
+  public: std::shared_ptr<ReaperHandle> reaperHandle;
+
+  /// \brief Watch for the exit of an executable with a pidfd on the
+  /// event loop, when supported.
+  /// \param[in,out] _exec The executable.
+  public: void WatchExit(Executable &_exec);
+
+  /// \brief Reap the executables that exited, without blocking. Must be
+  /// called with executablesMutex locked.
+  public: void Reap();
+
+  /// \brief Wait until all the executables are reaped, or a deadline.
+  /// \param[in] _lock Lock on executablesMutex.
+  /// \param[in] _deadline The deadline.
+  /// \return True if all the executables are reaped.
+  public: bool WaitForExit(std::unique_lock<std::mutex> &_lock,
+              const std::chrono::steady_clock::time_point &_deadline);
+
   /// \brief True indicates that this process is the main process.
   public: bool master = false;
 
@@ -180,6 +565,55 @@ class gz::test::ProcessManagerPrivate
   /// \brief Top level environment variables.
   public: std::list<std::string> envs;
 
+  /// \brief Mutex to protect the asynchronous launch state.
+  public: std::mutex launchMutex;
+
+  /// \brief Signaled when a queued launch completes.
+  public: std::condition_variable launchCv;
+
+  /// \brief Number of queued launches that have not completed.
+  public: unsigned int pendingLaunches{0};
+
+  /// \brief Incremented by Stop, to cancel the launches queued before.
+  public: uint64_t launchGeneration{0};
+
+  /// \brief Directory where the output of executables is logged, or an
+  /// empty string to let executables inherit the output of this process.
+  public: std::string logDir;
+
+  /// \brief Prefix of the log filenames.
+  public: std::string logPrefix;
+
+  /// \brief Maximum size of a log file, in bytes.
+  public: size_t logMaxSize{10 * 1024 * 1024};
+
+  /// \brief Maximum number of files per log, including rotated files.
+  public: unsigned int logMaxFiles{3};
+
+  /// \brief Paths of the logs that were created.
+  public: std::vector<std::string> logFiles;
+
+  /// \brief Mutex to protect the log settings and logFiles.
+  public: mutable std::mutex logMutex;
+
+  /// \brief Create pipes for the output of an executable, if its output
+  /// is logged.
+  /// \param[out] _out Read and write ends of the stdout pipe.
+  /// \param[out] _err Read and write ends of the stderr pipe.
+  /// \return True if the pipes were created.
+  public: bool OpenOutputPipes(int _out[2], int _err[2]);
+
+  /// \brief Drain the read end of the output pipes into log files, on
+  /// the event loop thread. Takes ownership of the file descriptors.
+  /// \param[in] _out Read end of the stdout pipe.
+  /// \param[in] _err Read end of the stderr pipe.
+  public: void LogOutput(int _out, int _err);
+
+  /// \brief Wait for all queued launches to complete.
+  /// \param[in] _cancel True to cancel the launches that have not
+  /// started.
+  public: void WaitForLaunches(bool _cancel);
+
   /// \brief Pointer to myself. This is used in the signal handlers.
   /// A raw pointer is acceptable here since it is used only internally.
   public: static ProcessManagerPrivate *myself;
@@ -202,7 +636,8 @@ ProcessManager::~ProcessManager()
 }
 
 /////////////////////////////////////////////////
-bool ProcessManager::RunExecutablesAsBash(const std::vector<std::string> &_cmds)
+bool ProcessManager::RunExecutablesAsBash(const std::vector<std::string> &_cmds,
+    const std::list<std::string> &_envs)
 {
   if (_cmds.empty())
     return true;
@@ -214,16 +649,16 @@ bool ProcessManager::RunExecutablesAsBash(const std::vector<std::string> &_cmds)
         return  _ss + ";" + _s;
       });
 
-  return this->RunExecutableAsBash(cmd);
+  return this->RunExecutableAsBash(cmd, _envs);
 }
 
 /////////////////////////////////////////////////
-bool ProcessManager::RunExecutableAsBash(const std::string &_cmd)
+bool ProcessManager::RunExecutableAsBash(const std::string &_cmd,
+    const std::list<std::string> &_envs)
 {
-  common::TempDirectory dir("before-script", "gz-test", false);
-  std::string filename = common::joinPaths(dir.Path(), "script.bash");
-  std::ofstream script(filename, std::ofstream::out);
-  std::string scriptHeader = R"header(#!/bin/bash
+  // The script is passed to bash on the command line, so that running it
+  // doesn't need any file.
+  std::string scriptHeader = R"header(
 
 list_descendants ()
 {
@@ -254,18 +689,50 @@ function userScript {
   std::string scriptFooter = R"footer(
 }
 # Run the script in the background so that we are able to trap signals.
-userScript >/tmp/stdout.log 2>/tmp/stderr.log &
+userScript &
 wait
 )footer";
 
-  script << scriptHeader << _cmd << scriptFooter;
-  script.close();
-
-  std::filesystem::permissions(filename, std::filesystem::perms::owner_all);
-  this->RunExecutable(filename, {filename}, {});
-  return true;
+  return this->RunExecutable("bash", {"bash", "-c",
+      scriptHeader + _cmd + scriptFooter}, _envs);
 }
 
+/////////////////////////////////////////////////
+void ProcessManager::RunExecutablesAsBashAsync(
+    const std::vector<std::string> &_cmds,
+    const std::list<std::string> &_envs,
+    const std::function<void(bool)> &_cb)
+{
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->launchMutex);
+    this->dataPtr->pendingLaunches++;
+    generation = this->dataPtr->launchGeneration;
+  }
+
+  // Stop waits for pending launches, so this is valid while the job runs.
+  LaunchQueue::Instance().Push([this, _cmds, _envs, _cb, generation]
+      {
+        bool cancelled;
+        {
+          std::lock_guard<std::mutex> lock(this->dataPtr->launchMutex);
+          cancelled = generation != this->dataPtr->launchGeneration;
+        }
+
+        if (!cancelled)
+        {
+          bool result = this->RunExecutablesAsBash(_cmds, _envs);
+          if (_cb)
+            _cb(result);
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(this->dataPtr->launchMutex);
+          this->dataPtr->pendingLaunches--;
+        }
+        this->dataPtr->launchCv.notify_all();
+      });
+}
 
 /////////////////////////////////////////////////
 bool ProcessManager::RunExecutable(const std::string &_name,
@@ -361,78 +828,246 @@ bool ProcessManager::RunExecutable(const std::string &_name,
           _name, thread, _cmd, _autoRestart, _envs));
   }
 #else
-  // Fork a process for the command
-  pid_t pid = fork();
+  std::string cmdStr = std::accumulate(
+      std::next(_cmd.begin()), _cmd.end(), _cmd[0],
+      [](std::string _ss, std::string _s)
+      {
+        return  _ss + " " + _s;
+      });
 
-  // If parent process...
-  if (pid)
+  // Capture the output of the executable when it is logged.
+  int outPipe[2] = {-1, -1};
+  int errPipe[2] = {-1, -1};
+  bool logOutput = this->dataPtr->OpenOutputPipes(outPipe, errPipe);
+  auto closePipes = [&]()
   {
-    gzdbg << "Forked a process for [" << _name << "] command["
-      << std::accumulate(std::next(_cmd.begin()), _cmd.end(), _cmd[0],
-          [](std::string _ss, std::string _s)
-          { return  _ss + " " + _s; }) << "]\n"
-      << std::flush;
+    for (int fd : {outPipe[0], outPipe[1], errPipe[0], errPipe[1]})
+    {
+      if (fd >= 0)
+        close(fd);
+    }
+  };
 
-    std::lock_guard<std::mutex> mutex(this->dataPtr->executablesMutex);
-    this->dataPtr->master = true;
-    // Store the PID in the parent process.
-    this->dataPtr->executables.push_back(Executable(_name, pid, _cmd, _envs));
+  pid_t pid = -1;
+  if (this->dataPtr->method == LaunchMethod::SPAWN)
+  {
+    int err = this->dataPtr->Spawn(_cmd, _envs, outPipe[1], errPipe[1], pid);
+    if (err != 0)
+    {
+      gzerr << "Unable to run command[" << cmdStr << "]: "
+        << std::strerror(err) << "\n";
+      closePipes();
+      return false;
+    }
   }
-  // Else child process...
   else
   {
-    // A child is not the master
-    this->dataPtr->master = false;
+    // Fork a process for the command
+    pid = fork();
+    if (pid < 0)
+    {
+      gzerr << "Unable to fork a process for command[" << cmdStr << "]: "
+        << std::strerror(errno) << "\n";
+      closePipes();
+      return false;
+    }
 
-    // Create a vector of char* in the child process
-    std::vector<char*> cstrings;
-    for (const std::string &part : _cmd)
+    // If child process...
+    if (pid == 0)
     {
-      cstrings.push_back(const_cast<char *>(part.c_str()));
+      // A child is not the master
+      this->dataPtr->master = false;
+
+      // Create a vector of char* in the child process
+      std::vector<char*> cstrings;
+      for (const std::string &part : _cmd)
+      {
+        cstrings.push_back(const_cast<char *>(part.c_str()));
+      }
+
+      // Add the nullptr termination.
+      cstrings.push_back(nullptr);
+
+      // Remove from foreground process group.
+      setpgid(0, 0);
+
+      if (logOutput)
+      {
+        dup2(outPipe[1], STDOUT_FILENO);
+        dup2(errPipe[1], STDERR_FILENO);
+      }
+
+      this->dataPtr->SetEnvs(_envs);
+
+      // Run the command, replacing the current process image
+      execvp(cstrings[0], &cstrings[0]);
+
+      // Don't return into a copy of the parent process.
+      gzerr << "Unable to run command[" << cmdStr << "]\n";
+      _exit(127);
     }
+  }
 
-    // Add the nullptr termination.
-    cstrings.push_back(nullptr);
+  gzdbg << "Launched a process for [" << _name << "] command["
+    << cmdStr << "]\n" << std::flush;
 
-    // Remove from foreground process group.
-    setpgid(0, 0);
+  if (logOutput)
+  {
+    close(outPipe[1]);
+    close(errPipe[1]);
+    this->dataPtr->LogOutput(outPipe[0], errPipe[0]);
+  }
 
-    this->dataPtr->SetEnvs(_envs);
+  std::lock_guard<std::mutex> mutex(this->dataPtr->executablesMutex);
+  this->dataPtr->master = true;
+  // Store the PID in the parent process.
+  this->dataPtr->executables.push_back(Executable(_name, pid, _cmd, _envs));
+  this->dataPtr->WatchExit(this->dataPtr->executables.back());
+#endif
+  return true;
+}
 
-    // Run the command, replacing the current process image
-    if (execvp(cstrings[0], &cstrings[0]) < 0)
+/////////////////////////////////////////////////
+void ProcessManager::SetLogDirectory(const std::string &_dir,
+    const std::string &_prefix)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logMutex);
+  this->dataPtr->logDir = _dir;
+  this->dataPtr->logPrefix = _prefix;
+}
+
+/////////////////////////////////////////////////
+void ProcessManager::SetLogLimits(size_t _maxSize, unsigned int _maxFiles)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logMutex);
+  this->dataPtr->logMaxSize = std::max<size_t>(_maxSize, 1);
+  this->dataPtr->logMaxFiles = std::max(_maxFiles, 1u);
+}
+
+/////////////////////////////////////////////////
+std::vector<std::string> ProcessManager::LogFiles() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->logMutex);
+  std::vector<std::string> files;
+  for (const std::string &log : this->dataPtr->logFiles)
+  {
+    // Oldest rotated file first.
+    for (unsigned int i = this->dataPtr->logMaxFiles - 1; i > 0; --i)
     {
-      gzerr << "Unable to run command["
-        << std::accumulate(
-            std::next(_cmd.begin()), _cmd.end(), _cmd[0],
-            [](std::string _ss, std::string _s)
-            {
-              return  _ss + " " + _s;
-            }) << "]\n";
-      return false;
+      std::string rotated = log + "." + std::to_string(i);
+      if (common::exists(rotated))
+        files.push_back(rotated);
     }
+    if (common::exists(log))
+      files.push_back(log);
+  }
+  return files;
+}
+
+/////////////////////////////////////////////////
+void ProcessManager::SetStopTimeouts(
+    const std::chrono::steady_clock::duration &_interrupt,
+    const std::chrono::steady_clock::duration &_terminate)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->executablesMutex);
+  this->dataPtr->interruptTimeout = _interrupt;
+  this->dataPtr->terminateTimeout = _terminate;
+}
+
+/////////////////////////////////////////////////
+ProcessManager::Stats ProcessManager::ExitStats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->executablesMutex);
+  return this->dataPtr->stats;
+}
+
+/////////////////////////////////////////////////
+void ProcessManager::SetMethod(LaunchMethod _method)
+{
+  this->dataPtr->method = _method;
+}
+
+/////////////////////////////////////////////////
+ProcessManager::LaunchMethod ProcessManager::Method() const
+{
+  return this->dataPtr->method;
+}
+
+/////////////////////////////////////////////////
+void ProcessManager::Wait()
+{
+  this->dataPtr->WaitForLaunches(false);
+
+#ifndef _WIN32
+  std::unique_lock<std::mutex> lock(this->dataPtr->executablesMutex);
+  this->dataPtr->WaitForExit(lock,
+      std::chrono::steady_clock::time_point::max());
+#else
+  std::list<Executable> executables;
+  {
+    std::lock_guard<std::mutex> mutex(this->dataPtr->executablesMutex);
+    executables = this->dataPtr->executables;
   }
+
+  // Don't hold the mutex while waiting, so that Stop can still be used to
+  // interrupt the executables.
+  for (const Executable &exec : executables)
+    WaitForSingleObject(exec.pi, INFINITE);
 #endif
-  return true;
 }
 
 /////////////////////////////////////////////////
 void ProcessManager::Stop()
 {
-  std::lock_guard<std::mutex> mutex(this->dataPtr->executablesMutex);
+  // Make sure nothing is launched once the executables are stopped.
+  this->dataPtr->WaitForLaunches(true);
 
 #ifndef _WIN32
-  // Remove the sigchld signal handler
-  signal(SIGCHLD, nullptr);
-#endif
+  std::unique_lock<std::mutex> lock(this->dataPtr->executablesMutex);
+
+  // Ask the executables to stop, and escalate to SIGTERM and then SIGKILL
+  // for the ones that don't stop in time. Signals are sent to the process
+  // group of each executable, so that its children are stopped as well.
+  const std::vector<std::pair<int, std::chrono::steady_clock::duration>>
+    steps = {
+      {SIGINT, this->dataPtr->interruptTimeout},
+      {SIGTERM, this->dataPtr->terminateTimeout},
+      {SIGKILL, std::chrono::steady_clock::duration::max()}};
+
+  for (const auto &[sig, timeout] : steps)
+  {
+    this->dataPtr->Reap();
+
+    bool running = false;
+    for (Executable &exec : this->dataPtr->executables)
+    {
+      if (!exec.running)
+        continue;
+
+      gzdbg << "Sending signal[" << sig << "] to the process[" << exec.name
+        << "] with PID[" << exec.pid << "]\n";
+      exec.stopped = true;
+      if (kill(-exec.pid, sig) != 0)
+        kill(exec.pid, sig);
+      running = true;
+    }
+
+    if (!running)
+      break;
+
+    auto now = std::chrono::steady_clock::now();
+    auto deadline = timeout >= std::chrono::steady_clock::time_point::max() -
+      now ? std::chrono::steady_clock::time_point::max() : now + timeout;
+    if (this->dataPtr->WaitForExit(lock, deadline))
+      break;
+  }
+#else
+  std::lock_guard<std::mutex> mutex(this->dataPtr->executablesMutex);
 
   // Create a vector of monitor threads that wait for each process to stop.
   std::vector<std::thread> monitors;
   for (const Executable &exec : this->dataPtr->executables)
     monitors.push_back(std::thread([&] {
-#ifndef _WIN32
-      waitpid(exec.pid, nullptr, 0);
-#else
       WaitForSingleObject(exec.pi, INFINITE);
       int retVal = ReleaseSemaphore(myself->stoppedChildSem, 1, nullptr);
       if (retVal != 0)
@@ -440,36 +1075,27 @@ void ProcessManager::Stop()
         gzerr << "Error Releasing Semaphore: "
                << GetLastErrorAsString() << std::endl;
       }
-#endif
     }));
 
   // Shutdown the processes
   for (const Executable &exec : this->dataPtr->executables)
-  {
-    gzdbg << "Killing the process[" << exec.name
-#ifndef _WIN32
-      << "] with PID[" << exec.pid << "]\n";
-    kill(exec.pid, SIGINT);
-#else
-  << "]\n";
-#endif
-  }
+    gzdbg << "Killing the process[" << exec.name << "]\n";
 
   gzdbg << "Waiting for each process to end\n";
 
   // Wait for all the monitors to stop
   for (std::thread &m : monitors)
     m.join();
+#endif
 }
 
 /////////////////////////////////////////////////
 ProcessManagerPrivate::ProcessManagerPrivate()
 {
-#ifndef _WIN32
-  // Register a signal handler to capture child process death events.
-  if (signal(SIGCHLD, ProcessManagerPrivate::OnSigChild) == SIG_ERR)
-    gzerr << "signal(2) failed while setting up for SIGCHLD" << std::endl;
+  this->reaperHandle = std::make_shared<ReaperHandle>();
+  this->reaperHandle->owner = this;
 
+#ifndef _WIN32
   // Register backward signal handler for other signals
   std::vector<int> signals =
   {
@@ -494,21 +1120,252 @@ ProcessManagerPrivate::ProcessManagerPrivate()
 }
 
 /////////////////////////////////////////////////
-void ProcessManagerPrivate::OnSigChild(int _sig)
+ProcessManagerPrivate::~ProcessManagerPrivate()
+{
+  std::lock_guard<std::mutex> lock(this->reaperHandle->mutex);
+  this->reaperHandle->owner = nullptr;
+}
+
+//////////////////////////////////////////////////
+void ProcessManagerPrivate::WatchExit(Executable &_exec)
+{
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  int fd = static_cast<int>(syscall(SYS_pidfd_open, _exec.pid, 0));
+  if (fd < 0)
+    return;
+
+  // A pidfd is readable once the process exits.
+  std::shared_ptr<ReaperHandle> handle = this->reaperHandle;
+  _exec.watched = EventLoop::Instance().Add(fd, [handle](int)
+      {
+        std::lock_guard<std::mutex> handleLock(handle->mutex);
+        if (handle->owner)
+        {
+          {
+            std::lock_guard<std::mutex> lock(
+                handle->owner->executablesMutex);
+            handle->owner->Reap();
+          }
+          handle->owner->exitCv.notify_all();
+        }
+        return false;
+      });
+#else
+  (void) _exec;
+#endif
+}
+
+//////////////////////////////////////////////////
+void ProcessManagerPrivate::Reap()
 {
-  // Retreive the stopped child's PID, append, and signal the consumer.
 #ifndef _WIN32
-  // This is a signal handler, so be careful not to do any operations
-  // that you are not allowed to do.
-  // Ref: http://man7.org/linux/man-pages/man7/signal-safety.7.html
-  (void) _sig;  // Commenting _sig above confuses codecheck
-  pid_t p;
-  int status;
-
-  if ((p = waitpid(-1, &status, WNOHANG)) != -1)
+  for (Executable &exec : this->executables)
   {
-    myself->stoppedChildren.push(p);
+    if (!exec.running)
+      continue;
+
+    int status = 0;
+    struct rusage usage{};
+    pid_t result = wait4(exec.pid, &status, WNOHANG, &usage);
+    if (result == exec.pid)
+    {
+      exec.running = false;
+      if (WIFEXITED(status))
+        exec.exitCode = WEXITSTATUS(status);
+      else if (WIFSIGNALED(status))
+        exec.exitCode = 128 + WTERMSIG(status);
+
+      this->stats.exitCount++;
+      this->stats.lastExitCode = exec.exitCode;
+      if (exec.exitCode != 0 && !exec.stopped)
+        this->stats.failCount++;
+      this->stats.cpuTime +=
+        std::chrono::seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+        std::chrono::microseconds(usage.ru_utime.tv_usec +
+            usage.ru_stime.tv_usec);
+      this->stats.maxRss = std::max<int64_t>(this->stats.maxRss,
+          usage.ru_maxrss);
+    }
+    else if (result < 0 && errno == ECHILD)
+    {
+      exec.running = false;
+    }
+  }
+#endif
+}
+
+//////////////////////////////////////////////////
+bool ProcessManagerPrivate::WaitForExit(std::unique_lock<std::mutex> &_lock,
+    const std::chrono::steady_clock::time_point &_deadline)
+{
+  while (true)
+  {
+    this->Reap();
+
+    bool running = false;
+    bool polled = false;
+    for (const Executable &exec : this->executables)
+    {
+      running = running || exec.running;
+      polled = polled || (exec.running && !exec.watched);
+    }
+
+    if (!running)
+      return true;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= _deadline)
+      return false;
+
+    // Executables without a pidfd are polled.
+    auto wakeup = _deadline;
+    if (polled && _deadline - now > 100ms)
+      wakeup = now + 100ms;
+    this->exitCv.wait_until(_lock, wakeup);
   }
+}
+
+//////////////////////////////////////////////////
+void ProcessManagerPrivate::WaitForLaunches(bool _cancel)
+{
+  std::unique_lock<std::mutex> lock(this->launchMutex);
+  if (_cancel)
+    this->launchGeneration++;
+  this->launchCv.wait(lock, [this] { return this->pendingLaunches == 0; });
+}
+
+#ifndef _WIN32
+//////////////////////////////////////////////////
+int ProcessManagerPrivate::Spawn(const std::vector<std::string> &_cmd,
+    const std::list<std::string> &_envs, int _outFd, int _errFd,
+    pid_t &_pid)
+{
+  // Build the environment of the child, where _envs overrides variables
+  // of this process.
+  std::unordered_set<std::string> names;
+  for (const std::string &env : _envs)
+    names.insert(env.substr(0, env.find('=')));
+
+  std::vector<char*> envp;
+  for (char **env = environ; env && *env; ++env)
+  {
+    std::string name(*env, std::strcspn(*env, "="));
+    if (names.find(name) == names.end())
+      envp.push_back(*env);
+  }
+  for (const std::string &env : _envs)
+    envp.push_back(const_cast<char *>(env.c_str()));
+  envp.push_back(nullptr);
+
+  std::vector<char*> argv;
+  for (const std::string &part : _cmd)
+    argv.push_back(const_cast<char *>(part.c_str()));
+  argv.push_back(nullptr);
+
+  // Put the child in its own process group, which removes it from the
+  // foreground process group, and don't let it inherit a blocked signal
+  // mask from the calling thread.
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t mask;
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  posix_spawnattr_setpgroup(&attr, 0);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+      POSIX_SPAWN_SETSIGMASK);
+
+  // Redirect the output. The pipes are close-on-exec, but dup2 clears the
+  // flag on the new file descriptors.
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if (_outFd >= 0)
+    posix_spawn_file_actions_adddup2(&actions, _outFd, STDOUT_FILENO);
+  if (_errFd >= 0)
+    posix_spawn_file_actions_adddup2(&actions, _errFd, STDERR_FILENO);
+
+  int err = posix_spawnp(&_pid, argv[0], &actions, &attr, argv.data(),
+      envp.data());
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  return err;
+}
+#endif
+
+//////////////////////////////////////////////////
+bool ProcessManagerPrivate::OpenOutputPipes(int _out[2], int _err[2])
+{
+#ifdef __linux__
+  {
+    std::lock_guard<std::mutex> lock(this->logMutex);
+    if (this->logDir.empty())
+      return false;
+  }
+
+  if (pipe2(_out, O_CLOEXEC) != 0)
+  {
+    gzwarn << "Unable to create a pipe, output is not logged: "
+      << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  if (pipe2(_err, O_CLOEXEC) != 0)
+  {
+    gzwarn << "Unable to create a pipe, output is not logged: "
+      << std::strerror(errno) << "\n";
+    close(_out[0]);
+    close(_out[1]);
+    _out[0] = _out[1] = -1;
+    return false;
+  }
+  return true;
+#else
+  (void) _out;
+  (void) _err;
+  return false;
+#endif
+}
+
+//////////////////////////////////////////////////
+void ProcessManagerPrivate::LogOutput(int _out, int _err)
+{
+#ifdef __linux__
+  std::string base;
+  size_t maxSize;
+  unsigned int maxFiles;
+  {
+    std::lock_guard<std::mutex> lock(this->logMutex);
+    common::createDirectories(this->logDir);
+    base = common::joinPaths(this->logDir, this->logPrefix + "-" +
+        std::to_string(this->logFiles.size() / 2));
+    this->logFiles.push_back(base + ".stdout.log");
+    this->logFiles.push_back(base + ".stderr.log");
+    maxSize = this->logMaxSize;
+    maxFiles = this->logMaxFiles;
+  }
+
+  for (auto [fd, filename] : {std::make_pair(_out, base + ".stdout.log"),
+                              std::make_pair(_err, base + ".stderr.log")})
+  {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    auto log = std::make_shared<RotatingLog>(filename, maxSize, maxFiles);
+    EventLoop::Instance().Add(fd, [log](int _fd)
+        {
+          char buffer[4096];
+          while (true)
+          {
+            ssize_t count = read(_fd, buffer, sizeof(buffer));
+            if (count > 0)
+              log->Write(buffer, static_cast<size_t>(count));
+            else if (count < 0 && errno == EINTR)
+              continue;
+            else
+              return count < 0 && errno == EAGAIN;
+          }
+        });
+  }
+#else
+  (void) _out;
+  (void) _err;
 #endif
 }
 
@@ -17,6 +17,14 @@
 #ifndef GZ_TEST_PROCESSMANAGER_HH_
 #define GZ_TEST_PROCESSMANAGER_HH_
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "gz/test/config.hh"
 
 namespace gz
@@ -30,14 +38,76 @@ namespace gz
 
     class ProcessManager
     {
+      /// \brief Ways to launch an executable.
+      public: enum class LaunchMethod
+      {
+        /// posix_spawn, which doesn't copy the address space of this
+        /// process. This is the default on Linux.
+        SPAWN,
+
+        /// fork, followed by exec.
+        FORK,
+      };
+
+      /// \brief Exit status and resource usage of the executables that
+      /// exited.
+      public: class Stats
+      {
+        /// \brief Number of executables that exited.
+        public: unsigned int exitCount{0};
+
+        /// \brief Number of executables that exited with a non-zero exit
+        /// code, not counting executables stopped by Stop.
+        public: unsigned int failCount{0};
+
+        /// \brief Exit code of the last executable that exited, or 128
+        /// plus the signal number if it was killed by a signal.
+        public: int lastExitCode{-1};
+
+        /// \brief Total user and system CPU time of the executables, and
+        /// of their children that they waited for.
+        public: std::chrono::steady_clock::duration cpuTime{0};
+
+        /// \brief Largest maximum resident set size of the executables, in
+        /// kilobytes.
+        public: int64_t maxRss{0};
+      };
+
       /// \brief Constructor
       public: ProcessManager();
 
       /// \brief Deonstructor
       public: ~ProcessManager();
 
-      public: bool RunExecutablesAsBash(const std::vector<std::string> &_cmds);
-      public: bool RunExecutableAsBash(const std::string &_cmd);
+      /// \brief Run a list of commands as a single bash script.
+      /// \param[in] _cmds The commands to run.
+      /// \param[in] _envs Environment variables to set, in "NAME=value"
+      /// form.
+      /// \return True on success.
+      public: bool RunExecutablesAsBash(const std::vector<std::string> &_cmds,
+                  const std::list<std::string> &_envs = {});
+
+      /// \brief Run a command as a bash script.
+      /// \param[in] _cmd The command to run.
+      /// \param[in] _envs Environment variables to set, in "NAME=value"
+      /// form.
+      /// \return True on success.
+      public: bool RunExecutableAsBash(const std::string &_cmd,
+                  const std::list<std::string> &_envs = {});
+
+      /// \brief Run a list of commands as a single bash script, without
+      /// blocking the caller. The script is written and launched by a
+      /// launcher thread shared by all process managers. Launches that are
+      /// still queued when Stop is called are cancelled.
+      /// \param[in] _cmds The commands to run.
+      /// \param[in] _envs Environment variables to set, in "NAME=value"
+      /// form.
+      /// \param[in] _cb Called from the launcher thread with the result of
+      /// the launch. Not called if the launch is cancelled.
+      public: void RunExecutablesAsBashAsync(
+                  const std::vector<std::string> &_cmds,
+                  const std::list<std::string> &_envs,
+                  const std::function<void(bool)> &_cb);
 
       /// \brief Fork a new process for a command specific by _cmd.
       /// \param[in] _name A unique name given to the command. This name is
@@ -51,8 +121,57 @@ namespace gz
         const std::vector<std::string> &_cmd,
         const std::list<std::string> &_envs);
 
+      /// \brief Log the stdout and stderr of executables launched from now
+      /// on. Each executable gets its own pair of size-capped, rotating log
+      /// files, named <_prefix>-<n>.stdout.log and <_prefix>-<n>.stderr.log.
+      /// Output is only logged on Linux.
+      /// \param[in] _dir Directory of the log files, or an empty string to
+      /// let executables inherit the output of this process.
+      /// \param[in] _prefix Prefix of the log filenames.
+      public: void SetLogDirectory(const std::string &_dir,
+                  const std::string &_prefix);
+
+      /// \brief Set the size limits of the log files. The defaults are
+      /// 10 MB per file, and 3 files per log.
+      /// \param[in] _maxSize Maximum size of a log file, in bytes.
+      /// \param[in] _maxFiles Maximum number of files per log. When a log
+      /// file is full it is rotated, and the oldest file is removed.
+      public: void SetLogLimits(size_t _maxSize, unsigned int _maxFiles);
+
+      /// \brief Get the log files that were written.
+      /// \return Paths to the log files, including rotated files.
+      public: std::vector<std::string> LogFiles() const;
+
+      /// \brief Get the exit status and resource usage of the executables
+      /// that exited.
+      /// \return The statistics.
+      public: Stats ExitStats() const;
+
+      /// \brief Set how executables are launched.
+      /// \param[in] _method The launch method.
+      public: void SetMethod(LaunchMethod _method);
+
+      /// \brief Get how executables are launched.
+      /// \return The launch method.
+      public: LaunchMethod Method() const;
+
+      /// \brief Wait for all running executables to exit on their own.
+      public: void Wait();
+
+      /// \brief Stop all running executables. Each executable's process
+      /// group is sent SIGINT, then SIGTERM if it is still running after
+      /// the interrupt timeout, then SIGKILL if it is still running after
+      /// the terminate timeout.
       public: void Stop();
 
+      /// \brief Set how long Stop waits before escalating. The defaults
+      /// are five seconds each.
+      /// \param[in] _interrupt Time to wait after SIGINT.
+      /// \param[in] _terminate Time to wait after SIGTERM.
+      public: void SetStopTimeouts(
+                  const std::chrono::steady_clock::duration &_interrupt,
+                  const std::chrono::steady_clock::duration &_terminate);
+
       /// \brief Private data pointer.
       // GZ_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       private: std::unique_ptr<ProcessManagerPrivate> dataPtr;
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <cmath>
+
+#include <gz/sim/Util.hh>
+#include <gz/sim/components/Model.hh>
+#include <gz/sim/components/Name.hh>
+#include <gz/sim/components/ParentEntity.hh>
+#include <gz/sim/components/Pose.hh>
+
+#include "RegionIndex.hh"
+
+using namespace gz;
+using namespace test;
+
+namespace
+{
+  /// \brief Regions that overlap more cells than this are not stored in
+  /// the grid.
+  const double kMaxCellsPerRegion = 512;
+
+  /// \brief Coordinates larger than this, in cells, are not stored in the
+  /// grid.
+  const double kMaxCellCoord = 1e15;
+
+  //////////////////////////////////////////////////
+  /// \brief Get the cell coordinate of a position along one axis.
+  /// \param[in] _value The position.
+  /// \param[in] _cellSize Edge length of a cell.
+  /// \param[out] _coord The cell coordinate.
+  /// \return False if the position can't be stored in the grid.
+  bool cellCoord(double _value, double _cellSize, int64_t &_coord)
+  {
+    double coord = std::floor(_value / _cellSize);
+    if (!std::isfinite(coord) || std::abs(coord) > kMaxCellCoord)
+      return false;
+    _coord = static_cast<int64_t>(coord);
+    return true;
+  }
+}
+
+//////////////////////////////////////////////////
+size_t RegionIndex::Add(const math::AxisAlignedBox &_box)
+{
+  this->boxes.push_back(_box);
+  this->contained.emplace_back();
+  this->built = false;
+  return this->boxes.size() - 1;
+}
+
+//////////////////////////////////////////////////
+void RegionIndex::Update(const sim::EntityComponentManager &_ecm)
+{
+  if (this->boxes.empty())
+    return;
+
+  if (!this->built)
+    this->Build();
+
+  // Forget models that are removed.
+  if (_ecm.HasEntitiesMarkedForRemoval())
+  {
+    _ecm.EachRemoved<sim::components::Model>(
+          [&](const sim::Entity &_entity,
+              const sim::components::Model *) -> bool
+          {
+            auto model = this->modelRegions.find(_entity);
+            if (model != this->modelRegions.end())
+            {
+              this->SetRegions(_entity, model->second, {});
+              this->modelRegions.erase(model);
+            }
+            return true;
+          });
+  }
+
+  auto updateModel = [&](const sim::Entity &_entity,
+                         const sim::components::Model *,
+                         const sim::components::Name *) -> bool
+  {
+    this->UpdateModel(_entity, _ecm);
+    return true;
+  };
+
+  // Evaluate every model the first time, and after a reset, since the
+  // pose components may not be marked as changed.
+  if (this->fullScan)
+  {
+    _ecm.Each<sim::components::Model, sim::components::Name>(updateModel);
+    this->fullScan = false;
+    return;
+  }
+
+  this->poseChanged.clear();
+  for (auto &[entity, regions] : this->modelRegions)
+  {
+    if (this->PoseChanged(entity, _ecm))
+      this->UpdateModel(entity, _ecm);
+  }
+
+  if (_ecm.HasNewEntities())
+  {
+    _ecm.EachNew<sim::components::Model, sim::components::Name>(
+        updateModel);
+  }
+}
+
+//////////////////////////////////////////////////
+void RegionIndex::UpdateModel(const sim::Entity &_entity,
+    const sim::EntityComponentManager &_ecm)
+{
+  math::Vector3d pos = sim::worldPose(_entity, _ecm).Pos();
+
+  std::vector<size_t> next;
+  auto testRegion = [&](size_t _id)
+  {
+    if (this->boxes[_id].Contains(pos))
+      next.push_back(_id);
+  };
+
+  int64_t x, y, z;
+  if (cellCoord(pos.X(), this->cellSize, x) &&
+      cellCoord(pos.Y(), this->cellSize, y) &&
+      cellCoord(pos.Z(), this->cellSize, z))
+  {
+    auto cell = this->cells.find(CellKey(x, y, z));
+    if (cell != this->cells.end())
+    {
+      for (size_t id : cell->second)
+        testRegion(id);
+    }
+  }
+
+  for (size_t id : this->largeRegions)
+    testRegion(id);
+
+  // A region can be listed twice in a cell when cell keys collide.
+  std::sort(next.begin(), next.end());
+  next.erase(std::unique(next.begin(), next.end()), next.end());
+
+  this->SetRegions(_entity, this->modelRegions[_entity], next);
+}
+
+//////////////////////////////////////////////////
+void RegionIndex::SetRegions(const sim::Entity &_entity,
+    std::vector<size_t> &_regions, const std::vector<size_t> &_next)
+{
+  if (_regions == _next)
+    return;
+
+  for (size_t id : _regions)
+  {
+    if (std::binary_search(_next.begin(), _next.end(), id))
+      continue;
+    std::vector<sim::Entity> &models = this->contained[id];
+    auto it = std::lower_bound(models.begin(), models.end(), _entity);
+    if (it != models.end() && *it == _entity)
+      models.erase(it);
+  }
+
+  for (size_t id : _next)
+  {
+    if (std::binary_search(_regions.begin(), _regions.end(), id))
+      continue;
+    std::vector<sim::Entity> &models = this->contained[id];
+    auto it = std::lower_bound(models.begin(), models.end(), _entity);
+    if (it == models.end() || *it != _entity)
+      models.insert(it, _entity);
+  }
+
+  _regions = _next;
+}
+
+//////////////////////////////////////////////////
+bool RegionIndex::PoseChanged(const sim::Entity &_entity,
+    const sim::EntityComponentManager &_ecm)
+{
+  auto memo = this->poseChanged.find(_entity);
+  if (memo != this->poseChanged.end())
+    return memo->second;
+
+  bool changed =
+    _ecm.ComponentState(_entity, sim::components::Pose::typeId) !=
+      sim::ComponentState::NoChange ||
+    _ecm.ComponentState(_entity, sim::components::ParentEntity::typeId) !=
+      sim::ComponentState::NoChange;
+
+  if (!changed)
+  {
+    sim::Entity parent = _ecm.ParentEntity(_entity);
+    if (parent != sim::kNullEntity)
+      changed = this->PoseChanged(parent, _ecm);
+  }
+
+  this->poseChanged[_entity] = changed;
+  return changed;
+}
+
+//////////////////////////////////////////////////
+const std::vector<sim::Entity> &RegionIndex::Contained(size_t _id) const
+{
+  return this->contained[_id];
+}
+
+//////////////////////////////////////////////////
+void RegionIndex::Reset()
+{
+  for (std::vector<sim::Entity> &models : this->contained)
+    models.clear();
+  this->modelRegions.clear();
+  this->fullScan = true;
+}
+
+//////////////////////////////////////////////////
+void RegionIndex::Build()
+{
+  this->cells.clear();
+  this->largeRegions.clear();
+
+  // Use the median of the largest dimension of the regions as the cell
+  // size, so that a typical region overlaps a handful of cells.
+  std::vector<double> extents;
+  for (const math::AxisAlignedBox &box : this->boxes)
+  {
+    math::Vector3d size = box.Max() - box.Min();
+    extents.push_back(std::max({size.X(), size.Y(), size.Z()}));
+  }
+  std::nth_element(extents.begin(), extents.begin() + extents.size() / 2,
+      extents.end());
+  this->cellSize = extents[extents.size() / 2];
+  if (!std::isfinite(this->cellSize) || this->cellSize <= 0)
+    this->cellSize = 1.0;
+
+  for (size_t id = 0; id < this->boxes.size(); ++id)
+  {
+    const math::AxisAlignedBox &box = this->boxes[id];
+    int64_t minX, minY, minZ, maxX, maxY, maxZ;
+    if (!cellCoord(box.Min().X(), this->cellSize, minX) ||
+        !cellCoord(box.Min().Y(), this->cellSize, minY) ||
+        !cellCoord(box.Min().Z(), this->cellSize, minZ) ||
+        !cellCoord(box.Max().X(), this->cellSize, maxX) ||
+        !cellCoord(box.Max().Y(), this->cellSize, maxY) ||
+        !cellCoord(box.Max().Z(), this->cellSize, maxZ) ||
+        static_cast<double>(maxX - minX + 1) *
+        static_cast<double>(maxY - minY + 1) *
+        static_cast<double>(maxZ - minZ + 1) > kMaxCellsPerRegion)
+    {
+      this->largeRegions.push_back(id);
+      continue;
+    }
+
+    for (int64_t x = minX; x <= maxX; ++x)
+    {
+      for (int64_t y = minY; y <= maxY; ++y)
+      {
+        for (int64_t z = minZ; z <= maxZ; ++z)
+          this->cells[CellKey(x, y, z)].push_back(id);
+      }
+    }
+  }
+
+  this->built = true;
+}
+
+//////////////////////////////////////////////////
+uint64_t RegionIndex::CellKey(int64_t _x, int64_t _y, int64_t _z)
+{
+  // Pack 21 bits of each coordinate. Cells that are far apart may share a
+  // key, which only adds candidates that fail the containment test.
+  const uint64_t mask = (1u << 21) - 1;
+  return ((static_cast<uint64_t>(_x) & mask) << 42) |
+    ((static_cast<uint64_t>(_y) & mask) << 21) |
+    (static_cast<uint64_t>(_z) & mask);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_REGIONINDEX_HH_
+#define GZ_TEST_REGIONINDEX_HH_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <gz/math/AxisAlignedBox.hh>
+#include <gz/sim/EntityComponentManager.hh>
+
+#include "gz/test/config.hh"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief Spatial index of the regions used by a test's region
+    /// triggers. Once per update, the world position of every model that
+    /// moved is computed once and tested only against the regions that are
+    /// near the model, using a uniform grid over the region boxes. A model
+    /// moved if its pose, or the pose of one of its ancestors, changed.
+    class RegionIndex
+    {
+      /// \brief Add a region to the index.
+      /// \param[in] _box The region.
+      /// \return Id of the region.
+      public: size_t Add(const math::AxisAlignedBox &_box);
+
+      /// \brief Compute which models are in each region.
+      /// \param[in] _ecm The entity component manager.
+      public: void Update(const sim::EntityComponentManager &_ecm);
+
+      /// \brief Get the models that were in a region at the last update.
+      /// \param[in] _id Id of the region.
+      /// \return The model entities, sorted.
+      public: const std::vector<sim::Entity> &Contained(size_t _id) const;
+
+      /// \brief Forget which models are in the regions.
+      public: void Reset();
+
+      /// \brief Compute the regions that contain a model, and update the
+      /// contents of the regions.
+      /// \param[in] _entity The model.
+      /// \param[in] _ecm The entity component manager.
+      private: void UpdateModel(const sim::Entity &_entity,
+                   const sim::EntityComponentManager &_ecm);
+
+      /// \brief Move a model from the regions it was in to other regions.
+      /// \param[in] _entity The model.
+      /// \param[in,out] _regions Sorted ids of the regions the model was
+      /// in. Set to _next.
+      /// \param[in] _next Sorted ids of the regions the model is in.
+      private: void SetRegions(const sim::Entity &_entity,
+                   std::vector<size_t> &_regions,
+                   const std::vector<size_t> &_next);
+
+      /// \brief Check if the world pose of an entity changed in the
+      /// current update.
+      /// \param[in] _entity The entity.
+      /// \param[in] _ecm The entity component manager.
+      /// \return True if the pose, or parent, of the entity or one of its
+      /// ancestors changed.
+      private: bool PoseChanged(const sim::Entity &_entity,
+                   const sim::EntityComponentManager &_ecm);
+
+      /// \brief Build the grid from the region boxes.
+      private: void Build();
+
+      /// \brief Get the key of the grid cell that contains a point.
+      /// \param[in] _x Cell x coordinate.
+      /// \param[in] _y Cell y coordinate.
+      /// \param[in] _z Cell z coordinate.
+      /// \return The key of the cell.
+      private: static uint64_t CellKey(int64_t _x, int64_t _y, int64_t _z);
+
+      /// \brief The region boxes, by id.
+      private: std::vector<math::AxisAlignedBox> boxes;
+
+      /// \brief The models in each region, by id.
+      private: std::vector<std::vector<sim::Entity>> contained;
+
+      /// \brief Edge length of a grid cell.
+      private: double cellSize{1.0};
+
+      /// \brief Ids of the regions that overlap each grid cell.
+      private: std::unordered_map<uint64_t, std::vector<size_t>> cells;
+
+      /// \brief Ids of the regions that span too many cells to be stored
+      /// in the grid. These are tested against every model.
+      private: std::vector<size_t> largeRegions;
+
+      /// \brief True if the grid is up to date with the region boxes.
+      private: bool built{false};
+
+      /// \brief Sorted ids of the regions that contain each model.
+      private: std::unordered_map<sim::Entity, std::vector<size_t>>
+               modelRegions;
+
+      /// \brief True if all models must be evaluated at the next update.
+      private: bool fullScan{true};
+
+      /// \brief Whether the world pose of entities changed, memoized
+      /// during an update so that shared ancestors are checked once.
+      private: std::unordered_map<sim::Entity, bool> poseChanged;
+    };
+    }
+  }
+}
+#endif
@@ -14,6 +14,8 @@
  * limitations under the License.
  *
 */
+#include <algorithm>
+
 #include <gz/sim/Link.hh>
 #include <gz/sim/Model.hh>
 #include <gz/sim/Util.hh>
@@ -25,6 +27,7 @@
 
 #include "Util.hh"
 #include "RegionTrigger.hh"
+#include "Test.hh"
 
 using namespace gz;
 using namespace test;
@@ -34,30 +37,24 @@ using namespace test;
 void RegionTrigger::Update(const sim::UpdateInfo &_info,
     Test *_test, const sim::EntityComponentManager &_ecm)
 {
-  // Update what this region contains.
-  _ecm.Each<sim::components::Model, sim::components::Name>(
-        [&](const sim::Entity &_entity,
-            const sim::components::Model *,
-            const sim::components::Name *_name) -> bool
-        {
-          math::Pose3d pose = sim::worldPose(_entity, _ecm);
-          std::string modelName = _name->Data();
-
-          if (this->box.Contains(pose.Pos()))
-          {
-            if (!this->Contains(modelName))
-            {
-              this->containedEntities.insert(modelName);
-              this->SetResult(this->RunOnCommands(_info, _test, _ecm));
-            }
-          }
-          else if (this->containedEntities.find(modelName) !=
-              this->containedEntities.end())
-          {
-            this->containedEntities.erase(modelName);
-          }
-          return true;
-        });
+  // Update what this region contains. The test's region index has
+  // already computed which models are in the region.
+  const std::vector<sim::Entity> &current =
+    _test->Regions().Contained(this->regionId);
+  if (current == this->containedEntities)
+    return;
+
+  // Update the contents first, so that the on commands see the models
+  // that entered the region as contained.
+  std::vector<sim::Entity> previous = std::move(this->containedEntities);
+  this->containedEntities = current;
+
+  // Run the on commands for each model that entered the region.
+  for (const sim::Entity &entity : this->containedEntities)
+  {
+    if (!std::binary_search(previous.begin(), previous.end(), entity))
+      this->SetResult(this->RunOnCommands(_info, _test, _ecm));
+  }
 }
 
 //////////////////////////////////////////////////
@@ -103,17 +100,20 @@ bool RegionTrigger::Load(const YAML::Node &_node)
   gzdbg << "Created region trigger " << this->Name() << " with box ["
     << this->box << "].\n";
 
-  std::function<bool(const std::string &)> func =
-    std::bind(&RegionTrigger::Contains, this, std::placeholders::_1);
+  TriggerFunction func = std::bind(&RegionTrigger::Contains, this,
+      std::placeholders::_1, std::placeholders::_2);
   this->RegisterFunction("contains", func);
 
   return true;
 }
 
 //////////////////////////////////////////////////
-bool RegionTrigger::Contains(const std::string &_name)
+bool RegionTrigger::Contains(const std::string &,
+    const sim::Entity &_entity)
 {
-  return this->containedEntities.find(_name) != this->containedEntities.end();
+  return _entity != sim::kNullEntity &&
+    std::binary_search(this->containedEntities.begin(),
+        this->containedEntities.end(), _entity);
 }
 
 //////////////////////////////////////////////////
@@ -121,3 +121,9 @@ void RegionTrigger::ResetImpl()
 {
   this->containedEntities.clear();
 }
+
+//////////////////////////////////////////////////
+bool RegionTrigger::CanRetrigger() const
+{
+  return true;
+}
@@ -18,6 +18,7 @@
 #define GZ_TEST_REGIONTRIGGER_HH_
 
 #include <chrono>
+#include <vector>
 #include <gz/math/AxisAlignedBox.hh>
 #include <gz/sim/World.hh>
 
@@ -43,12 +44,26 @@ namespace gz
                   Test *_test,
                   const sim::EntityComponentManager &_ecm) override;
 
-      public: bool Contains(const std::string &_name);
+      /// \brief Check if a model is in the region.
+      /// \param[in] _name Name of the model.
+      /// \param[in] _entity The model entity.
+      /// \return True if the model is in the region.
+      public: bool Contains(const std::string &_name,
+                  const sim::Entity &_entity);
 
       protected: void ResetImpl() override final;
 
+      /// \brief A region triggers every time a model enters it.
+      /// \return True.
+      protected: bool CanRetrigger() const override;
+
       public: math::AxisAlignedBox box;
-      public: std::unordered_set<std::string> containedEntities;
+
+      /// \brief Id of the region in the test's region index.
+      public: size_t regionId{0};
+
+      /// \brief The models in the region, sorted.
+      public: std::vector<sim::Entity> containedEntities;
     };
     }
   }
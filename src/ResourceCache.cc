@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+
+#include <gz/common/Console.hh>
+#include <gz/common/Filesystem.hh>
+#include <gz/common/URI.hh>
+#include <gz/common/Util.hh>
+#include <gz/fuel_tools/FuelClient.hh>
+#include <gz/fuel_tools/Interface.hh>
+#include <gz/fuel_tools/ModelIdentifier.hh>
+#include <gz/fuel_tools/WorldIdentifier.hh>
+
+#include "ResourceCache.hh"
+
+using namespace gz;
+using namespace test;
+
+namespace
+{
+  //////////////////////////////////////////////////
+  /// \brief Read a whole file.
+  /// \param[in] _filename Path to the file.
+  /// \param[out] _contents Contents of the file.
+  /// \return True if the file was read.
+  bool readFile(const std::string &_filename, std::string &_contents)
+  {
+    std::ifstream in(_filename, std::ios::binary);
+    if (!in)
+      return false;
+
+    std::ostringstream stream;
+    stream << in.rdbuf();
+    _contents = stream.str();
+    return true;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Write a file so that readers, possibly in other processes,
+  /// never see a partially written file.
+  /// \param[in] _filename Path to the file.
+  /// \param[in] _contents Contents of the file.
+  /// \return True if the file was written.
+  bool writeFileAtomic(const std::string &_filename,
+      const std::string &_contents)
+  {
+    common::createDirectories(common::parentPath(_filename));
+
+    std::string tmpFilename = _filename + ".tmp." + std::to_string(getpid());
+    {
+      std::ofstream out(tmpFilename, std::ios::binary);
+      if (!out || !(out << _contents))
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpFilename, _filename, ec);
+    if (ec)
+    {
+      std::filesystem::remove(tmpFilename, ec);
+      return false;
+    }
+    return true;
+  }
+}
+
+/// \brief Parsed SDF files, by key, shared by all caches of this process.
+/// A serialized copy of a parsed file would need to be parsed again when
+/// loaded, so parsed files are only kept in memory.
+static std::mutex gParsedMutex;
+static std::map<std::string, sdf::Root> gParsedRoots;
+
+/// \brief Private data for the ResourceCache class.
+class ResourceCache::Implementation
+{
+  /// \brief Path to the cache directory.
+  public: std::string path;
+
+  /// \brief Check whether a newer version of a Fuel model or world is
+  /// available, and download it.
+  /// \param[in] _uri URI of the model or world.
+  /// \param[in] _path Path the URI previously resolved to, which ends with
+  /// the cached version.
+  /// \return False if the latest version couldn't be checked or
+  /// downloaded.
+  public: bool UpdateToLatest(const std::string &_uri,
+              const std::string &_path) const;
+
+  /// \brief True to never use the network.
+  public: bool offline{false};
+
+  /// \brief Time after which a resolved URI is checked for a newer
+  /// version, when online.
+  public: std::chrono::hours ttl{24};
+};
+
+//////////////////////////////////////////////////
+bool ResourceCache::Implementation::UpdateToLatest(const std::string &_uri,
+    const std::string &_path) const
+{
+  fuel_tools::FuelClient client;
+  common::URI uri(_uri);
+  std::string cachedVersion = common::basename(_path);
+
+  // URIs with an explicit version always resolve to the same resource.
+  fuel_tools::ModelIdentifier model;
+  if (client.ParseModelUrl(uri, model))
+  {
+    if (model.Version() != 0)
+      return true;
+
+    fuel_tools::ModelIdentifier latest;
+    if (!client.ModelDetails(model, latest))
+      return false;
+
+    if (latest.VersionStr() == cachedVersion)
+      return true;
+
+    gzmsg << "Downloading version " << latest.VersionStr() << " of URI["
+      << _uri << "], cached version is " << cachedVersion << "\n";
+    return static_cast<bool>(client.DownloadModel(latest));
+  }
+
+  fuel_tools::WorldIdentifier world;
+  if (client.ParseWorldUrl(uri, world))
+  {
+    if (world.Version() != 0)
+      return true;
+
+    fuel_tools::WorldIdentifier latest;
+    if (!client.WorldDetails(world, latest))
+      return false;
+
+    if (latest.VersionStr() == cachedVersion)
+      return true;
+
+    gzmsg << "Downloading version " << latest.VersionStr() << " of URI["
+      << _uri << "], cached version is " << cachedVersion << "\n";
+    return static_cast<bool>(client.DownloadWorld(latest));
+  }
+
+  // Other resources, such as files within a model, follow the version of
+  // the model they belong to.
+  return true;
+}
+
+//////////////////////////////////////////////////
+ResourceCache::ResourceCache()
+  : dataPtr(utils::MakeImpl<Implementation>())
+{
+  std::string home;
+  common::env(GZ_HOMEDIR, home);
+  this->dataPtr->path = common::joinPaths(home, ".gz", "test", "cache");
+}
+
+//////////////////////////////////////////////////
+const std::string &ResourceCache::Path() const
+{
+  return this->dataPtr->path;
+}
+
+//////////////////////////////////////////////////
+void ResourceCache::SetPath(const std::string &_path)
+{
+  this->dataPtr->path = _path;
+}
+
+//////////////////////////////////////////////////
+bool ResourceCache::Offline() const
+{
+  return this->dataPtr->offline;
+}
+
+//////////////////////////////////////////////////
+void ResourceCache::SetOffline(bool _offline)
+{
+  this->dataPtr->offline = _offline;
+}
+
+//////////////////////////////////////////////////
+std::string ResourceCache::FetchResource(const std::string &_uri)
+{
+  // Local files don't need to be resolved.
+  if (common::exists(_uri))
+    return _uri;
+
+  // Use the previously resolved path, if it still exists. Once the entry
+  // has expired, and when online, check for a newer version first.
+  std::string entryFilename = common::joinPaths(this->dataPtr->path, "uris",
+      common::sha1(_uri));
+  std::string path;
+  if (readFile(entryFilename, path) && !path.empty() && common::exists(path))
+  {
+    std::error_code ec;
+    auto written = std::filesystem::last_write_time(entryFilename, ec);
+    bool expired = !ec && std::filesystem::file_time_type::clock::now() -
+      written > this->dataPtr->ttl;
+    if (this->dataPtr->offline || !expired)
+    {
+      igndbg << "Resolved URI[" << _uri << "] from cache[" << path << "]\n";
+      return path;
+    }
+
+    if (!this->dataPtr->UpdateToLatest(_uri, path))
+    {
+      gzwarn << "Unable to check URI[" << _uri << "] for a newer version, "
+        << "using cache[" << path << "]\n";
+      return path;
+    }
+  }
+
+  path.clear();
+  if (this->dataPtr->offline)
+  {
+    // Only look in the local Fuel cache.
+    fuel_tools::FuelClient client;
+    common::URI uri(_uri);
+    if (!client.CachedModel(uri, path) && !client.CachedWorld(uri, path))
+    {
+      gzerr << "Unable to resolve URI[" << _uri << "] in offline mode. "
+        << "Run once with network access to populate the cache.\n";
+      return "";
+    }
+  }
+  else
+  {
+    path = fuel_tools::fetchResource(_uri);
+  }
+
+  if (!path.empty() && !writeFileAtomic(entryFilename, path))
+    gzwarn << "Unable to write cache entry[" << entryFilename << "]\n";
+
+  return path;
+}
+
+//////////////////////////////////////////////////
+sdf::Errors ResourceCache::LoadSdf(const std::string &_filename,
+    sdf::Root &_root)
+{
+  std::string contents;
+  if (!readFile(_filename, contents))
+    return _root.Load(_filename);
+
+  // The key only covers the top-level file. Included resources are
+  // resolved through FetchResource, and a change in them is not detected.
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(_filename, ec);
+  std::string key = common::sha1(common::absPath(_filename) + "\n" +
+      std::to_string(mtime.time_since_epoch().count()) + "\n" +
+      common::sha1(contents));
+
+  std::lock_guard<std::mutex> lock(gParsedMutex);
+  auto iter = gParsedRoots.find(key);
+  if (iter != gParsedRoots.end())
+  {
+    igndbg << "Loaded SDF file[" << _filename << "] from memory\n";
+    _root = iter->second.Clone();
+    return {};
+  }
+
+  sdf::Errors errors = _root.Load(_filename);
+  if (errors.empty())
+    gParsedRoots.emplace(key, _root.Clone());
+
+  return errors;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_RESOURCECACHE_HH_
+#define GZ_TEST_RESOURCECACHE_HH_
+
+#include <string>
+
+#include <gz/utils/ImplPtr.hh>
+#include <sdf/Root.hh>
+
+#include "gz/test/config.hh"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief A cache of resolved resource URIs, shared across runs, and
+    /// of parsed SDF files, shared within a process.
+    ///
+    /// The cache directory contains uris/<sha1 of URI>, the local path a
+    /// URI resolved to. When online, entries older than a day are checked
+    /// for a newer version of unversioned Fuel models and worlds. Parsed
+    /// SDF files are kept in memory, keyed by the file path, modification
+    /// time and content hash.
+    class ResourceCache
+    {
+      /// \brief Default constructor. The cache is located in
+      /// ~/.gz/test/cache.
+      public: ResourceCache();
+
+      /// \brief Get the cache directory.
+      /// \return Path to the cache directory.
+      public: const std::string &Path() const;
+
+      /// \brief Set the cache directory.
+      /// \param[in] _path Path to the cache directory.
+      public: void SetPath(const std::string &_path);
+
+      /// \brief Get whether the cache is offline.
+      /// \return True if the network is never used.
+      public: bool Offline() const;
+
+      /// \brief Set whether the cache is offline. When offline, URIs are
+      /// resolved only from this cache and the local Fuel cache.
+      /// \param[in] _offline True to never use the network.
+      public: void SetOffline(bool _offline);
+
+      /// \brief Resolve a URI to a local path, fetching the resource from
+      /// Fuel if needed. This is suitable for use as an SDF find callback.
+      /// \param[in] _uri The URI to resolve.
+      /// \return The local path, or an empty string on failure.
+      public: std::string FetchResource(const std::string &_uri);
+
+      /// \brief Load an SDF file, reusing a copy parsed by this process
+      /// when the file has not changed.
+      /// \param[in] _filename Path to the SDF file.
+      /// \param[out] _root The loaded SDF root.
+      /// \return Errors that occurred while loading the file.
+      public: sdf::Errors LoadSdf(const std::string &_filename,
+                  sdf::Root &_root);
+
+      /// \brief Private data pointer.
+      GZ_UTILS_IMPL_PTR(dataPtr)
+    };
+    }
+  }
+}
+#endif
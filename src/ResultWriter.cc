@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+#include <google/protobuf/util/json_util.h>
+
+#include <gz/common/Console.hh>
+
+#include "ResultWriter.hh"
+
+using namespace gz;
+using namespace test;
+
+namespace
+{
+  //////////////////////////////////////////////////
+  /// \brief Write a buffer to a file descriptor, and flush it to disk.
+  /// \param[in] _fd The file descriptor.
+  /// \param[in] _data The data to write.
+  /// \return True if all the data was written and flushed.
+  bool writeAndSync(int _fd, const std::string &_data)
+  {
+    size_t written = 0;
+    while (written < _data.size())
+    {
+      ssize_t n = ::write(_fd, _data.data() + written,
+          _data.size() - written);
+      if (n < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      written += static_cast<size_t>(n);
+    }
+    return ::fsync(_fd) == 0;
+  }
+
+  //////////////////////////////////////////////////
+  /// \brief Open a file for appending, truncating it if it exists.
+  /// \param[in] _path Path to the file.
+  /// \return The file descriptor, or -1 on failure.
+  int openTruncated(const std::string &_path)
+  {
+    int fd = ::open(_path.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+      gzerr << "Unable to open results file[" << _path << "]: "
+        << std::strerror(errno) << "\n";
+    }
+    return fd;
+  }
+}
+
+class ResultWriter::Implementation
+{
+  /// \brief Close the open files.
+  public: void Close()
+          {
+            if (this->fd >= 0)
+              ::close(this->fd);
+            if (this->jsonFd >= 0)
+              ::close(this->jsonFd);
+            this->fd = -1;
+            this->jsonFd = -1;
+          }
+
+  /// \brief Binary stream file descriptor.
+  public: int fd{-1};
+
+  /// \brief JSON lines file descriptor, or -1 if not used.
+  public: int jsonFd{-1};
+
+  /// \brief Serializes writes from parallel tests.
+  public: std::mutex mutex;
+};
+
+/////////////////////////////////////////////////
+ResultWriter::ResultWriter()
+  : dataPtr(utils::MakeUniqueImpl<Implementation>())
+{
+}
+
+/////////////////////////////////////////////////
+ResultWriter::~ResultWriter()
+{
+  this->Close();
+}
+
+/////////////////////////////////////////////////
+bool ResultWriter::Open(const std::string &_path,
+    const std::string &_jsonPath)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->Close();
+
+  this->dataPtr->fd = openTruncated(_path);
+  if (this->dataPtr->fd < 0)
+    return false;
+
+  if (!_jsonPath.empty())
+  {
+    this->dataPtr->jsonFd = openTruncated(_jsonPath);
+    if (this->dataPtr->jsonFd < 0)
+    {
+      this->dataPtr->Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool ResultWriter::IsOpen() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->fd >= 0;
+}
+
+/////////////////////////////////////////////////
+bool ResultWriter::Write(const domain::Record &_record)
+{
+  // Serialize outside the lock, and write each record with a single
+  // write call, so that a crash leaves at most one partial record at the
+  // end of the stream.
+  std::ostringstream stream;
+  if (!google::protobuf::util::SerializeDelimitedToOstream(_record, &stream))
+    return false;
+
+  std::string json;
+  bool useJson = false;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    useJson = this->dataPtr->jsonFd >= 0;
+  }
+  if (useJson)
+  {
+    google::protobuf::util::JsonPrintOptions options;
+    options.preserve_proto_field_names = true;
+    if (!google::protobuf::util::MessageToJsonString(
+          _record, &json, options).ok())
+    {
+      return false;
+    }
+    json += "\n";
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  if (this->dataPtr->fd < 0)
+    return false;
+
+  bool result = writeAndSync(this->dataPtr->fd, stream.str());
+  if (this->dataPtr->jsonFd >= 0)
+    result = writeAndSync(this->dataPtr->jsonFd, json) && result;
+
+  if (!result)
+  {
+    gzerr << "Unable to write test result: " << std::strerror(errno)
+      << "\n";
+  }
+  return result;
+}
+
+/////////////////////////////////////////////////
+void ResultWriter::Close()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->Close();
+}
+
+/////////////////////////////////////////////////
+bool ResultWriter::Read(const std::string &_path,
+    const std::function<void(domain::Record &)> &_cb)
+{
+  std::ifstream in(_path, std::ios::binary);
+  if (!in)
+    return false;
+
+  google::protobuf::io::IstreamInputStream input(&in);
+  while (true)
+  {
+    domain::Record record;
+    bool cleanEof = false;
+    if (!google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+          &record, &input, &cleanEof))
+    {
+      if (!cleanEof)
+      {
+        gzwarn << "Ignoring incomplete record at the end of results file["
+          << _path << "]\n";
+      }
+      break;
+    }
+    _cb(record);
+  }
+  return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_RESULTWRITER_HH_
+#define GZ_TEST_RESULTWRITER_HH_
+
+#include <functional>
+#include <string>
+
+#include <gz/utils/ImplPtr.hh>
+
+#include "gz/test/config.hh"
+#include "msgs/record.pb.h"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief Appends test results to a stream of length-delimited binary
+    /// domain::Record messages, and optionally to a JSON lines file, as
+    /// soon as each test finishes. Every record is flushed to disk before
+    /// Write returns, so the results of finished tests survive a crash.
+    /// It is safe to call Write from several threads.
+    class ResultWriter
+    {
+      /// \brief Default constructor.
+      public: ResultWriter();
+
+      /// \brief Destructor. Closes the stream.
+      public: ~ResultWriter();
+
+      /// \brief Open a stream, truncating it if it exists.
+      /// \param[in] _path Path to the binary stream.
+      /// \param[in] _jsonPath Path to the JSON lines file, or an empty
+      /// string to only write the binary stream.
+      /// \return True if the files were opened.
+      public: bool Open(const std::string &_path,
+                  const std::string &_jsonPath = "");
+
+      /// \brief Get whether the stream is open.
+      /// \return True if the stream is open.
+      public: bool IsOpen() const;
+
+      /// \brief Append a record, and flush it to disk.
+      /// \param[in] _record The record to append.
+      /// \return True if the record was written.
+      public: bool Write(const domain::Record &_record);
+
+      /// \brief Close the stream.
+      public: void Close();
+
+      /// \brief Read the records of a binary stream. Reading stops at the
+      /// first incomplete record, such as one that was being written when
+      /// the writer crashed.
+      /// \param[in] _path Path to the binary stream.
+      /// \param[in] _cb Function called with each record.
+      /// \return True if the stream was opened.
+      public: static bool Read(const std::string &_path,
+                  const std::function<void(domain::Record &)> &_cb);
+
+      /// \brief Private data pointer.
+      GZ_UTILS_UNIQUE_IMPL_PTR(dataPtr)
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ResultWriter.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+/// \brief Fixture with a temporary directory for the result files.
+class ResultWriterTest : public ::testing::Test
+{
+  protected: void SetUp() override
+             {
+               this->dir = std::filesystem::temp_directory_path() /
+                 ("gz-test-result-writer-" + std::to_string(getpid()));
+               std::filesystem::create_directories(this->dir);
+             }
+
+  protected: void TearDown() override
+             {
+               std::filesystem::remove_all(this->dir);
+             }
+
+  /// \brief Create a record.
+  /// \param[in] _iteration Index of the iteration.
+  /// \return The record.
+  protected: static domain::Record MakeRecord(int _iteration)
+             {
+               domain::Record record;
+               record.set_iteration(_iteration);
+               record.set_test_index(1);
+               (*record.mutable_params())["velocity"] =
+                 std::to_string(_iteration);
+               record.set_ran(true);
+               record.mutable_test()->set_name(
+                   "test " + std::to_string(_iteration));
+               record.mutable_test()->set_failed(_iteration % 2 == 1);
+               return record;
+             }
+
+  /// \brief Read the records of a stream.
+  /// \param[in] _path Path to the stream.
+  /// \return The records.
+  protected: static std::vector<domain::Record> ReadAll(
+                 const std::string &_path)
+             {
+               std::vector<domain::Record> records;
+               EXPECT_TRUE(ResultWriter::Read(_path,
+                     [&](domain::Record &_record)
+                     {
+                       records.push_back(_record);
+                     }));
+               return records;
+             }
+
+  /// \brief Directory of the result files.
+  protected: std::filesystem::path dir;
+};
+
+/////////////////////////////////////////////////
+TEST_F(ResultWriterTest, WriteAndRead)
+{
+  std::string path = (this->dir / "results.pb").string();
+  std::string jsonPath = (this->dir / "results.jsonl").string();
+
+  ResultWriter writer;
+  EXPECT_FALSE(writer.IsOpen());
+  ASSERT_TRUE(writer.Open(path, jsonPath));
+  EXPECT_TRUE(writer.IsOpen());
+  for (int i = 0; i < 3; ++i)
+    EXPECT_TRUE(writer.Write(MakeRecord(i)));
+
+  // Records are on disk before the writer is closed.
+  std::vector<domain::Record> records = ReadAll(path);
+  ASSERT_EQ(3u, records.size());
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(i, records[i].iteration());
+    EXPECT_EQ(1, records[i].test_index());
+    EXPECT_EQ(std::to_string(i), records[i].params().at("velocity"));
+    EXPECT_TRUE(records[i].ran());
+    EXPECT_EQ("test " + std::to_string(i), records[i].test().name());
+    EXPECT_EQ(i % 2 == 1, records[i].test().failed());
+  }
+
+  // Each record is a line of JSON.
+  std::ifstream json(jsonPath);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(json, line);)
+    lines.push_back(line);
+  ASSERT_EQ(3u, lines.size());
+  EXPECT_NE(std::string::npos, lines[2].find("\"test_index\":1"));
+
+  writer.Close();
+  EXPECT_FALSE(writer.IsOpen());
+  EXPECT_FALSE(writer.Write(MakeRecord(3)));
+
+  // Opening the stream again truncates it.
+  ASSERT_TRUE(writer.Open(path));
+  EXPECT_TRUE(writer.Write(MakeRecord(4)));
+  writer.Close();
+  records = ReadAll(path);
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ(4, records[0].iteration());
+}
+
+/////////////////////////////////////////////////
+TEST_F(ResultWriterTest, TruncatedRecord)
+{
+  std::string path = (this->dir / "results.pb").string();
+  ResultWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  for (int i = 0; i < 3; ++i)
+    EXPECT_TRUE(writer.Write(MakeRecord(i)));
+  writer.Close();
+  uintmax_t size = std::filesystem::file_size(path);
+
+  // A crash while writing the last record leaves part of it at the end of
+  // the stream. Every complete record before it is still read.
+  for (uintmax_t cut : {1u, 5u})
+  {
+    std::filesystem::resize_file(path, size - cut);
+    std::vector<domain::Record> records = ReadAll(path);
+    ASSERT_EQ(2u, records.size()) << "cut " << cut;
+    EXPECT_EQ(0, records[0].iteration());
+    EXPECT_EQ(1, records[1].iteration());
+  }
+
+  // Only the length of the record was written.
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.put(static_cast<char>(100));
+  }
+  EXPECT_TRUE(ReadAll(path).empty());
+}
+
+/////////////////////////////////////////////////
+TEST_F(ResultWriterTest, MissingFiles)
+{
+  EXPECT_FALSE(ResultWriter::Read((this->dir / "missing.pb").string(),
+        [](domain::Record &) {}));
+
+  ResultWriter writer;
+  EXPECT_FALSE(writer.Open((this->dir / "missing" / "results.pb").string()));
+  EXPECT_FALSE(writer.IsOpen());
+}
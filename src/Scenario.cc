@@ -15,31 +15,201 @@
  *
 */
 #include <yaml-cpp/yaml.h>
-#include <regex>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #include <sdf/Model.hh>
+#include <sdf/Physics.hh>
 #include <sdf/Root.hh>
 #include <sdf/World.hh>
 
 #include <gz/common/SignalHandler.hh>
+#include <gz/common/StringUtils.hh>
+#include <gz/common/TempDirectory.hh>
+#include <gz/common/URI.hh>
+#include <gz/common/Util.hh>
 #include <gz/fuel_tools/Interface.hh>
+#include <gz/msgs/boolean.pb.h>
 #include <gz/msgs/stringmsg.pb.h>
+#include <gz/msgs/world_control.pb.h>
 #include <gz/sim/Util.hh>
 #include <gz/sim/Server.hh>
 #include <gz/math/Stopwatch.hh>
 
+#include <google/protobuf/util/json_util.h>
+
 #include <gz/transport/Node.hh>
 
+#include "msgs/progress.pb.h"
+#include "msgs/record.pb.h"
 #include "msgs/scenario.pb.h"
+#include "ParameterSearch.hh"
+#include "ParameterSweep.hh"
 #include "ProcessManager.hh"
+#include "ResourceCache.hh"
+#include "ResultWriter.hh"
 #include "Scenario.hh"
+#include "SequentialTest.hh"
 #include "Test.hh"
+#include "TestTemplate.hh"
 #include "TimeTrigger.hh"
 #include "Util.hh"
 
 using namespace gz;
 using namespace test;
 
+/////////////////////////////////////////////////
+/// \brief Parse the index in the name of a file of the worker directory,
+/// such as a running task "12" or a result "12.pb".
+/// \param[in] _path Path to the file.
+/// \return The index, or std::nullopt if the file isn't named after an
+/// index, like a temporary or editor swap file.
+static std::optional<size_t> indexFromPath(const std::filesystem::path &_path)
+{
+  std::string name = _path.stem().string();
+  size_t index = 0;
+  auto [end, ec] =
+    std::from_chars(name.data(), name.data() + name.size(), index);
+  if (ec != std::errc() || end != name.data() + name.size())
+    return std::nullopt;
+  return index;
+}
+
+/////////////////////////////////////////////////
+/// \brief Update the task counter that worker processes claim tasks from,
+/// while holding a lock on it. The counter is the "tickets" file of the
+/// work directory.
+/// \param[in] _workDir The work directory.
+/// \param[in] _update Function called with the index of the next task to
+/// claim, and the index past the last task to run. It may change both.
+/// \return True if the counter was updated.
+static bool updateTickets(const std::string &_workDir,
+    const std::function<void(size_t &, size_t &)> &_update)
+{
+  std::string path = common::joinPaths(_workDir, "tickets");
+  int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  // The lock is released when the file is closed.
+  bool result = false;
+  if (::flock(fd, LOCK_EX) == 0)
+  {
+    char buf[64] = {0};
+    size_t next = 0;
+    size_t end = 0;
+    if (::pread(fd, buf, sizeof(buf) - 1, 0) > 0 &&
+        std::sscanf(buf, "%zu %zu", &next, &end) == 2)
+    {
+      _update(next, end);
+      std::string data =
+        std::to_string(next) + " " + std::to_string(end) + "\n";
+      result = ::pwrite(fd, data.data(), data.size(), 0) ==
+        static_cast<ssize_t>(data.size()) &&
+        ::ftruncate(fd, static_cast<off_t>(data.size())) == 0;
+    }
+  }
+  ::close(fd);
+  return result;
+}
+
+/// \brief A system that forwards simulation callbacks to the test that is
+/// currently running. This lets a single server run several tests one
+/// after the other, since systems can't be removed from a server.
+class TestProxy :
+  public sim::System,
+  public sim::ISystemConfigure,
+  public sim::ISystemReset,
+  public sim::ISystemPreUpdate,
+  public sim::ISystemUpdate,
+  public sim::ISystemPostUpdate
+{
+  /// \brief Set the test that receives the simulation callbacks.
+  /// \param[in] _test The test, or nullptr for no test.
+  public: void SetTest(const std::shared_ptr<Test> &_test)
+          {
+            this->test = _test;
+
+            // Configure the test right away if the proxy was already
+            // configured by the server.
+            if (this->test && this->ecm)
+            {
+              this->test->Configure(this->worldEntity, this->sdf,
+                  *this->ecm, *this->eventMgr);
+            }
+          }
+
+  // Documentation inherited
+  public: void Configure(const sim::Entity &_entity,
+              const std::shared_ptr<const sdf::Element> &_sdf,
+              sim::EntityComponentManager &_ecm,
+              sim::EventManager &_eventMgr) override
+          {
+            this->worldEntity = _entity;
+            this->sdf = _sdf;
+            this->ecm = &_ecm;
+            this->eventMgr = &_eventMgr;
+            if (this->test)
+              this->test->Configure(_entity, _sdf, _ecm, _eventMgr);
+          }
+
+  // Documentation inherited
+  public: void Reset(const sim::UpdateInfo &,
+              sim::EntityComponentManager &) override
+          {
+            if (this->test)
+              this->test->Reset();
+          }
+
+  // Documentation inherited
+  public: void PreUpdate(const sim::UpdateInfo &_info,
+              sim::EntityComponentManager &_ecm) override
+          {
+            if (this->test)
+              this->test->PreUpdate(_info, _ecm);
+          }
+
+  // Documentation inherited
+  public: void Update(const sim::UpdateInfo &_info,
+              sim::EntityComponentManager &_ecm) override
+          {
+            if (this->test)
+              this->test->Update(_info, _ecm);
+          }
+
+  // Documentation inherited
+  public: void PostUpdate(const sim::UpdateInfo &_info,
+              const sim::EntityComponentManager &_ecm) override
+          {
+            if (this->test)
+              this->test->PostUpdate(_info, _ecm);
+          }
+
+  /// \brief The current test.
+  private: std::shared_ptr<Test> test;
+
+  /// \brief Arguments received in Configure.
+  private: sim::Entity worldEntity{sim::kNullEntity};
+  private: std::shared_ptr<const sdf::Element> sdf;
+  private: sim::EntityComponentManager *ecm{nullptr};
+  private: sim::EventManager *eventMgr{nullptr};
+};
+
 class Scenario::Implementation
 {
   public: Implementation()
@@ -55,12 +225,33 @@ class Scenario::Implementation
 
   public: Implementation &operator=(const Implementation &_impl)
           {
+            // Copy the configuration, but not the state of a run.
             this->name = _impl.name;
             this->description = _impl.description;
             this->worldFilename = _impl.worldFilename;
             this->models = _impl.models;
             this->tests = _impl.tests;
             this->serverConfig = _impl.serverConfig;
+            this->stepSize = _impl.stepSize;
+            this->baseLogPath = _impl.baseLogPath;
+            this->recordSimState = _impl.recordSimState;
+            this->beforeScript = _impl.beforeScript;
+            this->jobs = _impl.jobs;
+            this->parameters = _impl.parameters;
+            this->iterations = _impl.iterations;
+            this->sweep = _impl.sweep;
+            this->earlyStop = _impl.earlyStop;
+            this->search = _impl.search;
+            this->failFast = _impl.failFast;
+            this->testTemplates = _impl.testTemplates;
+            this->processes = _impl.processes;
+            this->workerCmd = _impl.workerCmd;
+            this->reuseServer = _impl.reuseServer;
+            this->worldName = _impl.worldName;
+            this->cache = _impl.cache;
+            this->streamJson = _impl.streamJson;
+            this->resultFormat = _impl.resultFormat;
+            this->progressRate = _impl.progressRate;
 
             this->CreateSigHandler();
             return *this;
@@ -91,6 +282,10 @@ class Scenario::Implementation
   public: std::vector<std::shared_ptr<Test>> tests;
   public: sim::ServerConfig serverConfig;
 
+  /// \brief Physics step size of the world, used to convert simulation
+  /// time limits into iterations.
+  public: std::chrono::steady_clock::duration stepSize{1ms};
+
   public: std::string baseLogPath{""};
   public: bool recordSimState = true;
 
@@ -103,8 +298,16 @@ class Scenario::Implementation
   public: ProcessManager processManager;
 
   public: common::SignalHandler sigHandler;
-  public: std::unique_ptr<sim::Server> server{nullptr};
-  public: bool run{false};
+  public: std::atomic<bool> run{false};
+
+  /// \brief Number of tests to run in parallel.
+  public: unsigned int jobs{1};
+
+  /// \brief Mutex that protects the running servers and tests.
+  public: std::mutex runningMutex;
+
+  /// \brief Servers that are currently running.
+  public: std::set<sim::Server *> servers;
 
   public: class Param
           {
@@ -116,11 +319,1085 @@ class Scenario::Implementation
   public: typedef std::map<std::string, Param> ParameterMap;
   public: ParameterMap parameters;
   public: std::vector<ParameterMap> iterations;
-  public: size_t iteration{0};
 
-  public: std::vector<std::string> testYaml;
+  /// \brief Generator of the iterations, used instead of the explicit
+  /// iterations when the scenario has a sweep.
+  public: std::optional<ParameterSweep> sweep;
+
+  /// \brief Sequential test that stops launching iterations once the pass
+  /// rate is decided, if the scenario enables early stopping.
+  public: std::optional<SequentialTest> earlyStop;
+
+  /// \brief Search of a parameter's pass/fail boundary, if the scenario
+  /// has a search. The iterations are added as values are probed.
+  public: std::optional<ParameterSearch> search;
+
+  /// \brief Finished tests of an iteration that is not complete.
+  public: class PendingIteration
+          {
+            /// \brief Number of finished tests.
+            public: size_t testCount{0};
+
+            /// \brief True if a test failed.
+            public: bool failed{false};
+
+            /// \brief True if a test didn't run, such as when its before
+            /// script failed or it was aborted.
+            public: bool skipped{false};
+          };
+
+  /// \brief Iterations that are not complete. Protected by
+  /// earlyStopMutex, along with earlyStop, iterationPassed and
+  /// completedIterations.
+  public: std::map<size_t, PendingIteration> pendingIterations;
+  public: std::mutex earlyStopMutex;
+
+  /// \brief Whether each complete iteration passed, when searching.
+  public: std::map<size_t, bool> iterationPassed;
+
+  /// \brief Outcomes of the complete iterations that are waiting for an
+  /// earlier iteration to complete before being added to earlyStop.
+  /// Iterations without an outcome are std::nullopt.
+  public: std::map<size_t, std::optional<bool>> completedIterations;
+
+  /// \brief Index of the next iteration to add to earlyStop.
+  public: size_t nextObservedIteration{0};
+
+  /// \brief True if iterations were skipped by early stopping.
+  public: std::atomic<bool> stoppedEarly{false};
+
+  /// \brief When tests stop early because they failed.
+  public: enum class FailFast
+          {
+            /// \brief Tests run until all their triggers have a result,
+            /// or their time limit is reached.
+            NONE,
+
+            /// \brief A test stops as soon as one of its triggers fails.
+            TEST,
+
+            /// \brief A test stops as soon as one of its triggers fails,
+            /// and all other tests of the scenario are aborted.
+            SCENARIO,
+          };
+
+  /// \brief Fail-fast policy of the scenario. Tests can override whether
+  /// they stop as soon as they fail.
+  public: FailFast failFast{FailFast::NONE};
+
+  /// \brief True once a test failed under the SCENARIO fail-fast policy.
+  /// No test starts after it is set.
+  public: std::atomic<bool> aborted{false};
+
+  /// \brief Abort the remaining tests after a test failed, if the
+  /// fail-fast policy is SCENARIO. Running tests are stopped, and are not
+  /// counted in the results.
+  /// \param[in] _failed True if the test failed.
+  /// \return True if the remaining tests were aborted.
+  public: bool AbortIfFailed(bool _failed);
+
+  /// \brief Templates of the tests, in scenario file order.
+  public: std::vector<TestTemplate> testTemplates;
+
+  /// \brief A single test of a single iteration. Tasks are independent
+  /// of each other, and may be run in any order.
+  public: class Task
+          {
+            /// \brief Index of the iteration.
+            public: size_t iteration{0};
+
+            /// \brief Index of the test in the scenario file.
+            public: size_t test{0};
+
+            /// \brief True if the before script succeeded and the test
+            /// was run.
+            public: bool ran{false};
+
+            /// \brief The test result. This is null if the task was never
+            /// started.
+            public: std::unique_ptr<domain::Test> result;
+          };
+
+  /// \brief Get the number of iterations.
+  /// \return The number of explicit or generated iterations.
+  public: uint64_t IterationCount() const;
+
+  /// \brief Get the parameters of an iteration. Parameters that the
+  /// iteration doesn't set have their default value.
+  /// \param[in] _iteration Index of the iteration.
+  /// \return The parameters.
+  public: ParameterMap IterationParams(size_t _iteration) const;
+
+  /// \brief Get the number of tasks, one for every test of every
+  /// iteration.
+  /// \return The number of tasks.
+  public: size_t TaskCount() const;
+
+  /// \brief Create a task. Tasks are ordered by iteration, then by test,
+  /// and are created as they are run, so that large sweeps don't need to
+  /// be held in memory.
+  /// \param[in] _index Index of the task.
+  /// \return The task.
+  public: Task CreateTask(size_t _index) const;
+
+  /// \brief Create the result record of a task. The task's result is
+  /// moved into the record.
+  /// \param[in,out] _task The finished task.
+  /// \return The record.
+  public: domain::Record CreateRecord(Task &_task) const;
+
+  /// \brief Append the result of a finished task to the results stream.
+  /// The result is released once it is in the stream, and kept in the
+  /// task otherwise.
+  /// \param[in,out] _task The finished task.
+  public: void StoreResult(Task &_task);
+
+  /// \brief Run a range of tasks, one at a time, in this process.
+  /// Parallel tests run in worker processes instead, see RunProcesses.
+  /// \param[out] _unstreamed Finished tasks whose result could not be
+  /// appended to the results stream.
+  /// \param[in] _begin Index of the first task.
+  /// \param[in] _end Index past the last task.
+  public: void RunTasks(std::vector<Task> &_unstreamed, size_t _begin,
+              size_t _end);
+
+  /// \brief Run the iterations of a parameter search, one probed value
+  /// at a time, in this process.
+  /// \param[out] _unstreamed Finished tasks whose result could not be
+  /// appended to the results stream.
+  public: void RunSearch(std::vector<Task> &_unstreamed);
+
+  /// \brief Record that a test of an iteration finished, for early
+  /// stopping and parameter searches. An iteration passes if none of its
+  /// tests failed. Iterations with a test that didn't run have no outcome,
+  /// and don't count toward the pass rate.
+  /// \param[in] _iteration Index of the iteration.
+  /// \param[in] _ran True if the test ran.
+  /// \param[in] _failed True if the test ran and failed.
+  /// \return True if the iteration's outcome decided the sequential test.
+  public: bool ObserveTest(size_t _iteration, bool _ran, bool _failed);
+
+  /// \brief Collect the result that a worker process wrote for a task.
+  /// The result is observed for early stopping, appended to the results
+  /// stream, and removed from the work directory. A task that was claimed
+  /// but has no result is reported as failed.
+  /// \param[in] _workDir The shared work directory.
+  /// \param[in] _index Index of the task.
+  /// \param[out] _unstreamed Receives the task if its result could not be
+  /// appended to the results stream.
+  /// \return True if the result decided the sequential test.
+  public: bool CollectResult(const std::string &_workDir, size_t _index,
+              std::vector<Task> &_unstreamed);
+
+  /// \brief Stop the worker processes from claiming the tasks of the
+  /// iterations that haven't started, once the sequential test is
+  /// decided.
+  /// \param[in] _workDir The shared work directory.
+  public: void StopDecidedTasks(const std::string &_workDir);
+
+  /// \brief Run all tasks using a pool of worker processes.
+  /// \param[out] _unstreamed Finished tasks whose result could not be
+  /// appended to the results stream.
+  public: void RunProcesses(std::vector<Task> &_unstreamed);
+
+  /// \brief Claim the next task for a worker process. Tasks are claimed
+  /// in order from a counter shared by the workers, and a marker of the
+  /// claimed task is left in the "running" directory until its result is
+  /// written.
+  /// The total number of tests is lowered to the end of the counter,
+  /// which early stopping and aborting lower.
+  /// \param[in] _workDir The shared work directory.
+  /// \return Index of the claimed task, or std::nullopt if there are no
+  /// tasks left.
+  public: std::optional<size_t> ClaimTask(const std::string &_workDir);
+
+  /// \brief A server used by one worker. The server may be reused by
+  /// consecutive tasks run by the worker.
+  public: class ServerSlot
+          {
+            /// \brief The server, or nullptr if the worker doesn't have
+            /// a server yet.
+            public: std::unique_ptr<sim::Server> server;
+
+            /// \brief The system that forwards to the current test.
+            public: std::shared_ptr<TestProxy> proxy;
+
+            /// \brief Log record settings the server was created with.
+            public: bool useLogRecord{false};
+            public: std::string logRecordPath;
+          };
+
+  /// \brief Get a server for a task, reusing the slot's server when the
+  /// scenario allows it and the configuration matches.
+  /// \param[in,out] _slot The worker's server slot.
+  /// \param[in] _config Server configuration required by the task.
+  public: void PrepareServer(ServerSlot &_slot,
+              const sim::ServerConfig &_config);
+
+  /// \brief Restore the initial world state of the slot's server.
+  /// \param[in] _slot The worker's server slot.
+  /// \return True if the world was reset.
+  public: bool ResetServer(ServerSlot &_slot);
+
+  /// \brief Create a test for the given iteration, substituting the
+  /// iteration's parameters into the test description.
+  /// \param[in] _iteration Index of the iteration.
+  /// \param[in] _test Index of the test in the scenario file.
+  /// \return The loaded test.
+  public: std::shared_ptr<Test> CreateTest(size_t _iteration,
+              size_t _test) const;
+
+  /// \brief Run a task, and store its result in the task.
+  /// \param[in,out] _task The task to run.
+  /// \param[in,out] _slot The server slot of the worker running the task.
+  public: void RunTask(Task &_task, ServerSlot &_slot);
+
+  /// \brief Number of worker processes.
+  public: unsigned int processes{1};
+
+  /// \brief Command, with arguments, used to launch a worker process.
+  public: std::vector<std::string> workerCmd;
+
+  /// \brief True to reuse a server across tests, resetting the world
+  /// between tests.
+  public: bool reuseServer{false};
+
+  /// \brief Name of the world.
+  public: std::string worldName;
+
+  /// \brief Cache of resolved resources and parsed SDF files.
+  public: ResourceCache cache;
+
+  /// \brief Stream that each test result is appended to as soon as the
+  /// test finishes.
+  public: ResultWriter resultWriter;
+
+  /// \brief True to also stream the results as JSON lines.
+  public: bool streamJson{false};
+
+  /// \brief Format of the scenario result.
+  public: ResultFormat resultFormat{ResultFormat::PBTXT};
+
+  /// \brief Start publishing progress messages.
+  /// \param[in] _partition Gazebo Transport partition of the progress
+  /// topic, or an empty string for the current partition.
+  /// \param[in] _totalTestCount Number of tests over all iterations, or
+  /// zero if unknown.
+  public: void StartProgress(const std::string &_partition,
+              int _totalTestCount);
+
+  /// \brief Stop publishing progress messages.
+  public: void StopProgress();
+
+  /// \brief Queue a progress message for publication. This never
+  /// blocks: the message is dropped if the queue is busy.
+  /// \param[in] _msg The progress message.
+  public: void QueueProgress(domain::Progress &_msg);
+
+  /// \brief Rate, in Hz, at which the progress of each running test is
+  /// published. Zero disables progress.
+  public: double progressRate{1.0};
+
+  /// \brief Node and publisher of the progress topic.
+  public: std::unique_ptr<transport::Node> progressNode;
+  public: transport::Node::Publisher progressPub;
+
+  /// \brief Progress messages waiting to be published, protected by
+  /// progressMutex.
+  public: std::vector<domain::Progress> progressQueue;
+  public: std::mutex progressMutex;
+  public: std::condition_variable progressCv;
+  public: bool progressDone{false};
+
+  /// \brief Thread that publishes the queued progress messages, so that
+  /// publishing never blocks the simulation.
+  public: std::thread progressThread;
+
+  /// \brief Number of tests that finished, and total number of tests,
+  /// or zero if the total is unknown.
+  public: std::atomic<int> completedTestCount{0};
+  public: std::atomic<int> totalTestCount{0};
+
+  /// \brief Lower the total number of tests, once it is known that only
+  /// the tasks before _end will run. An unknown total stays unknown.
+  /// \param[in] _end Index past the last task that will run.
+  public: void LimitTestCount(size_t _end);
 };
 
+/////////////////////////////////////////////////
+uint64_t Scenario::Implementation::IterationCount() const
+{
+  if (this->sweep)
+    return this->sweep->Count();
+  return this->iterations.size();
+}
+
+/////////////////////////////////////////////////
+Scenario::Implementation::ParameterMap
+Scenario::Implementation::IterationParams(size_t _iteration) const
+{
+  ParameterMap params = this->parameters;
+  if (!this->sweep)
+  {
+    for (const std::pair<const std::string, Param> &param :
+        this->iterations.at(_iteration))
+    {
+      params[param.first].name = param.first;
+      params[param.first].value = param.second.value;
+    }
+    return params;
+  }
+
+  for (const std::pair<std::string, std::string> &value :
+      this->sweep->Values(_iteration))
+  {
+    params[value.first].name = value.first;
+    params[value.first].value = value.second;
+  }
+  return params;
+}
+
+/////////////////////////////////////////////////
+size_t Scenario::Implementation::TaskCount() const
+{
+  return this->IterationCount() * this->testTemplates.size();
+}
+
+/////////////////////////////////////////////////
+Scenario::Implementation::Task Scenario::Implementation::CreateTask(
+    size_t _index) const
+{
+  Task task;
+  task.iteration = _index / this->testTemplates.size();
+  task.test = _index % this->testTemplates.size();
+  return task;
+}
+
+/////////////////////////////////////////////////
+domain::Record Scenario::Implementation::CreateRecord(Task &_task) const
+{
+  domain::Record record;
+  record.set_iteration(static_cast<int32_t>(_task.iteration));
+  record.set_test_index(static_cast<int32_t>(_task.test));
+  for (const std::pair<const std::string, Implementation::Param> &param :
+      this->IterationParams(_task.iteration))
+  {
+    (*record.mutable_params())[param.first] = param.second.value;
+  }
+  record.set_ran(_task.ran);
+  record.set_allocated_test(_task.result.release());
+  return record;
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::StoreResult(Task &_task)
+{
+  if (!_task.result || !this->resultWriter.IsOpen())
+    return;
+
+  domain::Record record = this->CreateRecord(_task);
+  if (!this->resultWriter.Write(record))
+  {
+    // Keep the result in memory, so that it is still part of the final
+    // scenario result.
+    _task.result.reset(record.release_test());
+  }
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::StartProgress(const std::string &_partition,
+    int _totalTestCount)
+{
+  this->totalTestCount = _totalTestCount;
+  this->completedTestCount = 0;
+  if (this->progressRate <= 0)
+    return;
+
+  transport::NodeOptions opts;
+  if (!_partition.empty())
+    opts.SetPartition(_partition);
+  this->progressNode = std::make_unique<transport::Node>(opts);
+  this->progressPub =
+    this->progressNode->Advertise<domain::Progress>("/test/progress");
+
+  this->progressDone = false;
+  this->progressThread = std::thread([this]()
+  {
+    std::vector<domain::Progress> msgs;
+    std::unique_lock<std::mutex> lock(this->progressMutex);
+    while (!this->progressDone)
+    {
+      this->progressCv.wait(lock, [this]()
+          {
+            return this->progressDone || !this->progressQueue.empty();
+          });
+      msgs.swap(this->progressQueue);
+      lock.unlock();
+      for (domain::Progress &msg : msgs)
+        this->progressPub.Publish(msg);
+      msgs.clear();
+      lock.lock();
+    }
+  });
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::LimitTestCount(size_t _end)
+{
+  // Several threads may lower the total at once. Keep the lowest.
+  int total = this->totalTestCount;
+  while (total > 0 && static_cast<size_t>(total) > _end)
+  {
+    if (this->totalTestCount.compare_exchange_weak(total,
+          static_cast<int>(_end)))
+    {
+      break;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::StopProgress()
+{
+  if (!this->progressThread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(this->progressMutex);
+    this->progressDone = true;
+  }
+  this->progressCv.notify_all();
+  this->progressThread.join();
+  this->progressQueue.clear();
+  this->progressPub = transport::Node::Publisher();
+  this->progressNode.reset();
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::QueueProgress(domain::Progress &_msg)
+{
+  _msg.set_completed_test_count(this->completedTestCount);
+  _msg.set_total_test_count(this->totalTestCount);
+
+  // Drop the message rather than wait for the publisher thread. The test
+  // reports its progress again after the next period.
+  std::unique_lock<std::mutex> lock(this->progressMutex, std::try_to_lock);
+  if (!lock.owns_lock() || this->progressDone)
+    return;
+  this->progressQueue.push_back(std::move(_msg));
+  lock.unlock();
+  this->progressCv.notify_one();
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::RunTasks(std::vector<Task> &_unstreamed,
+    size_t _begin, size_t _end)
+{
+  // Once early stopping decides, no task of an iteration that hasn't
+  // started is run.
+  size_t iterationLimit = std::numeric_limits<size_t>::max();
+
+  ServerSlot slot;
+  for (size_t i = _begin; i < _end && this->run && !this->aborted; ++i)
+  {
+    Task task = this->CreateTask(i);
+    if (task.iteration >= iterationLimit)
+    {
+      this->stoppedEarly = true;
+      break;
+    }
+
+    this->RunTask(task, slot);
+    bool finished = static_cast<bool>(task.result);
+    bool ran = finished && task.ran;
+    bool failed = ran && task.result->failed();
+    this->StoreResult(task);
+    if (task.result)
+      _unstreamed.push_back(std::move(task));
+    this->AbortIfFailed(failed);
+
+    if (finished && this->ObserveTest(i / this->testTemplates.size(),
+          ran, failed))
+    {
+      iterationLimit = i / this->testTemplates.size() + 1;
+      this->LimitTestCount(iterationLimit * this->testTemplates.size());
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::RunSearch(std::vector<Task> &_unstreamed)
+{
+  const size_t testCount = this->testTemplates.size();
+  while (this->run)
+  {
+    std::optional<std::string> value = this->search->Next();
+    if (!value)
+      break;
+
+    // Each probed value is a new iteration.
+    Param param;
+    param.name = this->search->Parameter();
+    param.value = *value;
+    this->iterations.push_back({{param.name, param}});
+    const size_t iteration = this->iterations.size() - 1;
+
+    igndbg << "Probing " << param.name << "[" << param.value << "]\n";
+    this->RunTasks(_unstreamed, iteration * testCount,
+        (iteration + 1) * testCount);
+
+    std::lock_guard<std::mutex> lock(this->earlyStopMutex);
+    auto outcome = this->iterationPassed.find(iteration);
+    if (outcome == this->iterationPassed.end())
+    {
+      if (this->run)
+      {
+        gzerr << "Probe of " << param.name << "[" << param.value
+          << "] has a test that didn't run, stopping the search\n";
+      }
+      break;
+    }
+    gzmsg << param.name << "[" << param.value << "] "
+      << (outcome->second ? "passed" : "failed") << "\n";
+    this->search->Report(outcome->second);
+  }
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::RunProcesses(std::vector<Task> &_unstreamed)
+{
+  namespace fs = std::filesystem;
+
+  // The work directory holds the task counter, a marker for each running
+  // task, and the results of the tasks.
+  std::unique_ptr<common::TempDirectory> tempDir;
+  std::string workDir;
+  if (!this->baseLogPath.empty())
+  {
+    workDir = common::joinPaths(this->baseLogPath, "shards");
+  }
+  else
+  {
+    tempDir = std::make_unique<common::TempDirectory>(
+        "shards", "gz-test", true);
+    workDir = tempDir->Path();
+  }
+  fs::remove_all(workDir);
+
+  // Workers claim tasks in order from a shared counter, so that the work
+  // directory doesn't grow with the number of tasks, and early stopping
+  // and aborting only need to lower the end of the counter.
+  fs::create_directories(fs::path(workDir) / "running");
+  fs::create_directories(fs::path(workDir) / "results");
+  const size_t taskCount = this->TaskCount();
+  std::ofstream(fs::path(workDir) / "tickets") << 0 << " " << taskCount
+    << "\n";
+
+  // Each parallel test runs in its own worker process. Gazebo Transport
+  // reads the partition from the environment, which can't be changed
+  // safely while other threads of a process use it.
+  const unsigned int workerCount = this->processes * this->jobs;
+  const unsigned int failCount = this->processManager.ExitStats().failCount;
+  for (unsigned int w = 0; w < workerCount; ++w)
+  {
+    std::vector<std::string> cmd = this->workerCmd;
+    cmd.push_back("--worker-dir");
+    cmd.push_back(workDir);
+    cmd.push_back("--worker-id");
+    cmd.push_back(std::to_string(w));
+
+    // Each worker runs in its own transport partition, and publishes its
+    // progress in this process' partition.
+    this->processManager.RunExecutable("worker-" + std::to_string(w), cmd,
+        {"GZ_PARTITION=gz-test-" + std::to_string(getpid()) + "-" +
+         std::to_string(w),
+         "GZ_TEST_PROGRESS_PARTITION=" +
+           transport::NodeOptions().Partition()});
+  }
+
+  // Collect the results while the workers run, so that they reach the
+  // results stream as soon as they are finished. A result is finished
+  // once its worker clears the task's running marker.
+  std::set<size_t> collected;
+  auto collectFinished = [&]()
+  {
+    std::vector<size_t> finished;
+    std::error_code ec;
+    for (const fs::directory_entry &entry :
+         fs::directory_iterator(fs::path(workDir) / "results", ec))
+    {
+      // Skip results that are still being written.
+      if (entry.path().extension() != ".pb")
+        continue;
+
+      std::optional<size_t> index = indexFromPath(entry.path());
+      if (index && !collected.count(*index) &&
+          !fs::exists(fs::path(workDir) / "running" / std::to_string(*index)))
+      {
+        finished.push_back(*index);
+      }
+    }
+
+    for (size_t index : finished)
+    {
+      collected.insert(index);
+      if (this->CollectResult(workDir, index, _unstreamed))
+        this->StopDecidedTasks(workDir);
+    }
+  };
+
+  std::mutex watchMutex;
+  std::condition_variable watchCv;
+  bool workersDone = false;
+  std::thread watcher([&]()
+  {
+    std::unique_lock<std::mutex> lock(watchMutex);
+    while (!watchCv.wait_for(lock, 1s, [&]() {return workersDone;}))
+      collectFinished();
+  });
+
+  this->processManager.Wait();
+
+  {
+    std::lock_guard<std::mutex> lock(watchMutex);
+    workersDone = true;
+  }
+  watchCv.notify_all();
+  watcher.join();
+
+  unsigned int failedWorkers =
+    this->processManager.ExitStats().failCount - failCount;
+  if (failedWorkers > 0)
+  {
+    gzerr << failedWorkers << " of " << workerCount
+      << " worker processes exited with an error\n";
+  }
+
+  if (fs::exists(fs::path(workDir) / "aborted"))
+    this->aborted = true;
+
+  // Collect the results that were finished after the last check, and the
+  // tasks that were lost with their worker. Tasks after the last claimed
+  // task never started.
+  size_t claimedCount = taskCount;
+  updateTickets(workDir, [&](size_t &_next, size_t &)
+      {
+        claimedCount = std::min(_next, taskCount);
+      });
+  for (size_t i = 0; i < claimedCount; ++i)
+  {
+    if (!collected.count(i))
+      this->CollectResult(workDir, i, _unstreamed);
+  }
+
+  if (!tempDir)
+    fs::remove_all(workDir);
+}
+
+/////////////////////////////////////////////////
+bool Scenario::Implementation::AbortIfFailed(bool _failed)
+{
+  if (!_failed || this->failFast != FailFast::SCENARIO || this->aborted)
+    return false;
+
+  gzmsg << "A test failed, aborting the remaining tests\n";
+  std::lock_guard<std::mutex> lock(this->runningMutex);
+  this->aborted = true;
+  for (sim::Server *server : this->servers)
+    server->Stop();
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool Scenario::Implementation::ObserveTest(size_t _iteration, bool _ran,
+    bool _failed)
+{
+  if (!this->earlyStop && !this->search)
+    return false;
+
+  std::lock_guard<std::mutex> lock(this->earlyStopMutex);
+  PendingIteration &pending = this->pendingIterations[_iteration];
+  pending.testCount++;
+  pending.failed = pending.failed || _failed;
+  pending.skipped = pending.skipped || !_ran;
+  if (pending.testCount < this->testTemplates.size())
+    return false;
+
+  bool passed = !pending.failed;
+  bool skipped = pending.skipped;
+  this->pendingIterations.erase(_iteration);
+  if (skipped)
+  {
+    gzwarn << "Iteration " << _iteration << " has a test that didn't run, "
+      << "it doesn't count toward the pass rate\n";
+  }
+  else if (this->search)
+  {
+    this->iterationPassed[_iteration] = passed;
+  }
+  if (!this->earlyStop)
+    return false;
+
+  // Parallel iterations complete out of order, and failing iterations
+  // often complete first, so outcomes are added to the sequential test in
+  // iteration order.
+  this->completedIterations[_iteration] =
+    skipped ? std::nullopt : std::optional<bool>(passed);
+  bool decided = false;
+  for (auto it = this->completedIterations.begin();
+       it != this->completedIterations.end() &&
+       it->first == this->nextObservedIteration;
+       it = this->completedIterations.erase(it))
+  {
+    if (it->second)
+      decided = this->earlyStop->Add(*it->second) || decided;
+    this->nextObservedIteration++;
+  }
+  if (!decided)
+    return false;
+
+  domain::SequentialTest state;
+  this->earlyStop->FillResults(&state);
+  gzmsg << "Pass rate decided "
+    << domain::SequentialTest::Decision_Name(state.decision())
+    << " after " << state.pass_count() + state.fail_count()
+    << " iterations, with confidence " << state.confidence() << "\n";
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool Scenario::Implementation::CollectResult(const std::string &_workDir,
+    size_t _index, std::vector<Task> &_unstreamed)
+{
+  namespace fs = std::filesystem;
+  fs::path resultPath =
+    fs::path(_workDir) / "results" / (std::to_string(_index) + ".pb");
+  fs::path runningPath = fs::path(_workDir) / "running" /
+    std::to_string(_index);
+
+  Task task = this->CreateTask(_index);
+  ResultWriter::Read(resultPath.string(), [&](domain::Record &_record)
+      {
+        if (!_record.has_test())
+          return;
+        task.ran = _record.ran();
+        task.result.reset(_record.release_test());
+      });
+
+  // A task that was claimed but has no result was lost with its worker,
+  // which most likely crashed while running it. Report it as failed.
+  if (!task.result)
+  {
+    if (!fs::exists(runningPath))
+      return false;
+
+    std::string name = this->CreateTest(task.iteration, task.test)->Name();
+    gzerr << "Test[" << name << "] iteration " << task.iteration
+      << " did not finish, its worker process exited\n";
+    task.ran = true;
+    task.result = std::make_unique<domain::Test>();
+    task.result->set_name(name);
+    task.result->set_failed(true);
+  }
+
+  bool decided = this->ObserveTest(task.iteration, task.ran,
+      task.ran && task.result->failed());
+
+  this->StoreResult(task);
+  if (task.result)
+    _unstreamed.push_back(std::move(task));
+
+  // The result is in the stream or in memory now, so the work directory
+  // only holds the results that haven't been collected.
+  std::error_code ec;
+  fs::remove(resultPath, ec);
+  fs::remove(runningPath, ec);
+  return decided;
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::StopDecidedTasks(const std::string &_workDir)
+{
+  // Iterations that have started are completed, and the tasks of all
+  // other iterations are not run. Tasks are claimed in order, so the
+  // started iterations are the ones before the next task.
+  const size_t testCount = this->testTemplates.size();
+  updateTickets(_workDir, [&](size_t &_next, size_t &_end)
+      {
+        size_t limit = (_next + testCount - 1) / testCount * testCount;
+        if (limit < _end)
+        {
+          _end = limit;
+          this->stoppedEarly = true;
+        }
+      });
+}
+
+/////////////////////////////////////////////////
+std::optional<size_t> Scenario::Implementation::ClaimTask(
+    const std::string &_workDir)
+{
+  // The marker is created while holding the lock, so that a task is never
+  // claimed without one, even if the worker crashes right after.
+  std::optional<size_t> index;
+  updateTickets(_workDir, [&](size_t &_next, size_t &_end)
+      {
+        this->LimitTestCount(_end);
+        if (_next >= _end)
+          return;
+        index = _next++;
+        std::ofstream(common::joinPaths(_workDir, "running",
+              std::to_string(*index)));
+      });
+  return index;
+}
+
+/////////////////////////////////////////////////
+std::shared_ptr<Test> Scenario::Implementation::CreateTest(
+    size_t _iteration, size_t _test) const
+{
+  const TestTemplate &testTemplate = this->testTemplates.at(_test);
+  const ParameterMap params = this->IterationParams(_iteration);
+
+  // Look up the value of each placeholder of the test.
+  std::vector<const std::string *> values;
+  values.reserve(testTemplate.Names().size());
+  for (const std::string &paramName : testTemplate.Names())
+  {
+    auto iter = params.find(paramName);
+    values.push_back(iter != params.end() ? &iter->second.value : nullptr);
+  }
+
+  std::shared_ptr<Test> test = std::make_shared<Test>();
+  test->Load(testTemplate.Bind(values));
+  if (!test->FailFast().has_value())
+    test->SetFailFast(this->failFast != FailFast::NONE);
+  return test;
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::PrepareServer(ServerSlot &_slot,
+    const sim::ServerConfig &_config)
+{
+  // Tests that record sim state each need their own log, so they always
+  // get a new server. LoadConfiguration disables reuse in that case, but
+  // the configuration of the slot is checked in case it changes.
+  bool reuse = this->reuseServer && _slot.server &&
+    _slot.useLogRecord == _config.UseLogRecord() &&
+    (!_config.UseLogRecord() ||
+     _slot.logRecordPath == _config.LogRecordPath());
+
+  if (reuse)
+  {
+    if (this->ResetServer(_slot))
+      return;
+    gzwarn << "Unable to reset world[" << this->worldName
+      << "], restarting the server\n";
+  }
+
+  _slot.server.reset();
+  _slot.server = std::make_unique<sim::Server>(_config);
+
+  // The server's constructor replaces the SDF find callback with one that
+  // always uses the network. Restore the cache, which honors offline mode.
+  sdf::setFindCallback(std::bind(&ResourceCache::FetchResource,
+        &this->cache, std::placeholders::_1));
+
+  _slot.proxy = std::make_shared<TestProxy>();
+  _slot.server->AddSystem(_slot.proxy);
+  _slot.useLogRecord = _config.UseLogRecord();
+  _slot.logRecordPath = _config.LogRecordPath();
+}
+
+/////////////////////////////////////////////////
+bool Scenario::Implementation::ResetServer(ServerSlot &_slot)
+{
+  transport::Node node;
+
+  msgs::WorldControl req;
+  req.mutable_reset()->set_all(true);
+  msgs::Boolean rep;
+  bool result = false;
+  const unsigned int timeout = 5000;
+  bool executed = node.Request("/world/" + this->worldName + "/control",
+      req, timeout, rep, result);
+  if (!executed || !result || !rep.data())
+    return false;
+
+  // Step once, paused, so that the server processes the reset.
+  return _slot.server->RunOnce(true);
+}
+
+/////////////////////////////////////////////////
+void Scenario::Implementation::RunTask(Task &_task, ServerSlot &_slot)
+{
+  std::pair<int64_t, int64_t> timePair;
+  math::Stopwatch testWatch;
+  testWatch.Start(true);
+
+  std::shared_ptr<Test> test = this->CreateTest(_task.iteration, _task.test);
+
+  igndbg << "Running Test[" << test->Name() << "] iteration "
+    << _task.iteration << "\n";
+
+  // Tests running in parallel each get their own copy of the server
+  // configuration.
+  sim::ServerConfig config = this->serverConfig;
+  if (!this->baseLogPath.empty())
+  {
+    std::string testLogPath = common::joinPaths(this->baseLogPath,
+        test->Name(), std::to_string(_task.iteration));
+    config.SetUseLogRecord(this->recordSimState);
+    config.SetLogRecordPath(testLogPath);
+    test->SetLogPath(common::joinPaths(testLogPath, "commands"));
+  }
+  else
+  {
+    config.SetUseLogRecord(false);
+  }
+
+  _task.result = std::make_unique<domain::Test>();
+  domain::Test *testResult = _task.result.get();
+  testResult->set_name(test->Name());
+  timePair = timePointToSecNsec(std::chrono::system_clock::now());
+  testResult->mutable_start_time()->set_seconds(timePair.first);
+  testResult->mutable_start_time()->set_nanos(timePair.second);
+
+  // HERE: Setup a correct region trigger.
+  //       Capture console logs
+  //       A trigger can trigger anohter trigger.
+  //       Build and release docker image.
+  //       Update ci-test repo so that multiple tests are triggered.
+  //       Capture robot trajectory.
+  //       Plot robot trajectory in browswer and show changes over time.
+
+  bool beforeScriptSuccessful =
+    this->processManager.RunExecutablesAsBash(this->beforeScript);
+
+  if (!beforeScriptSuccessful)
+    return;
+
+  this->PrepareServer(_slot, config);
+  _slot.proxy->SetTest(test);
+
+  // \todo I think a behavior tree, or state machine would serve us
+  // better here.
+  sim::Server *serverPtr = _slot.server.get();
+  std::atomic<bool> stoppedByTest{false};
+  std::function<void()> stopCb = [serverPtr, &stoppedByTest]() {
+    stoppedByTest = true;
+    serverPtr->Stop();
+  };
+  test->SetStopCallback(stopCb);
+
+  if (this->progressPub)
+  {
+    const Task &task = _task;
+    test->SetProgressCallback([this, &task](domain::Progress &_msg)
+        {
+          _msg.set_iteration(static_cast<int32_t>(task.iteration));
+          _msg.set_test_index(static_cast<int32_t>(task.test));
+          this->QueueProgress(_msg);
+        },
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / this->progressRate)));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->runningMutex);
+    if (!this->run || this->aborted)
+    {
+      _slot.proxy->SetTest(nullptr);
+      _task.result.reset();
+      return;
+    }
+    this->servers.insert(serverPtr);
+    this->tests.push_back(test);
+  }
+
+  // A simulation time limit is converted to a number of iterations using
+  // the world's physics step size.
+  uint64_t iterations = 0;
+  if (test->MaxDurationType() == TimeType::SIM && test->MaxDuration() > 0s)
+  {
+    iterations = (test->MaxDuration() + this->stepSize - 1ns) /
+      this->stepSize;
+  }
+
+  // A real time limit is enforced by a watchdog that stops the server.
+  std::mutex watchdogMutex;
+  std::condition_variable watchdogCv;
+  bool serverDone = false;
+  std::atomic<bool> realLimitReached{false};
+  std::thread watchdog;
+  if (test->MaxDurationType() == TimeType::REAL && test->MaxDuration() > 0s)
+  {
+    watchdog = std::thread([&]()
+    {
+      std::unique_lock<std::mutex> lock(watchdogMutex);
+      if (!watchdogCv.wait_for(lock, test->MaxDuration(),
+            [&]() {return serverDone;}))
+      {
+        realLimitReached = true;
+        serverPtr->Stop();
+      }
+    });
+  }
+
+  _slot.server->Run(true, iterations, false);
+  testWatch.Stop();
+
+  {
+    std::lock_guard<std::mutex> lock(watchdogMutex);
+    serverDone = true;
+  }
+  watchdogCv.notify_all();
+  if (watchdog.joinable())
+    watchdog.join();
+
+  // A test that another test's failure stopped didn't run to its end.
+  const bool abortedTest =
+    this->aborted && !stoppedByTest && !realLimitReached;
+
+  // Report the time limit that stopped the test, if any.
+  if (abortedTest)
+  {
+    gzmsg << "Test[" << test->Name() << "] was aborted\n";
+  }
+  else if (realLimitReached)
+  {
+    gzmsg << "Test[" << test->Name() << "] reached its real time limit\n";
+    testResult->set_time_limit(domain::Test::REAL_TIME);
+  }
+  else if (iterations > 0 && !stoppedByTest && this->run)
+  {
+    gzmsg << "Test[" << test->Name() << "] reached its sim time limit\n";
+    testResult->set_time_limit(domain::Test::SIM_TIME);
+  }
+
+  timePair = math::durationToSecNsec(testWatch.ElapsedRunTime());
+  testResult->mutable_duration()->set_seconds(timePair.first);
+  testResult->mutable_duration()->set_nanos(timePair.second);
+
+  // Stop the commands started by the triggers, so that their exit status
+  // and resource usage are part of the results.
+  test->Stop();
+  test->FillResults(testResult);
+  _task.ran = !abortedTest;
+  this->completedTestCount++;
+
+  {
+    std::lock_guard<std::mutex> lock(this->runningMutex);
+    this->servers.erase(serverPtr);
+    this->tests.erase(std::remove(this->tests.begin(), this->tests.end(),
+          test), this->tests.end());
+  }
+
+  _slot.proxy->SetTest(nullptr);
+  if (!this->reuseServer)
+    _slot.server.reset();
+}
+
 /////////////////////////////////////////////////
 void Scenario::Implementation::LoadConfiguration(const YAML::Node &_config)
 {
@@ -140,6 +1417,10 @@ void Scenario::Implementation::LoadConfiguration(const YAML::Node &_config)
   // Load all the models, if any
   if (_config["models"])
   {
+    // Models that have been loaded, by URI. Each distinct URI is parsed
+    // once, and copied for every instance.
+    std::map<std::string, sdf::Model> loadedModels;
+
     for (YAML::const_iterator it = _config["models"].begin();
         it!=_config["models"].end(); ++it)
     {
@@ -149,17 +1430,30 @@ void Scenario::Implementation::LoadConfiguration(const YAML::Node &_config)
       if ((*it)["uri"])
       {
         std::string uri = (*it)["uri"].as<std::string>();
-        std::string modelPath = fuel_tools::fetchResource(uri);
-        std::string modelSdfFile = fuel_tools::sdfFromPath(modelPath);
+        auto loaded = loadedModels.find(uri);
+        if (loaded == loadedModels.end())
+        {
+          std::string modelPath = this->cache.FetchResource(uri);
+          std::string modelSdfFile = fuel_tools::sdfFromPath(modelPath);
+
+          sdf::Root root;
+          sdf::Errors errors = this->cache.LoadSdf(modelSdfFile, root);
 
-        sdf::Root root;
-        sdf::Errors errors = root.Load(modelSdfFile);
+          for (sdf::Error &err : errors)
+            gzerr << err.Message() << std::endl;
 
-        for (sdf::Error &err : errors)
-          gzerr << err.Message() << std::endl;
+          if (!root.Model())
+          {
+            gzerr << "model URI[" << uri << "] does not contain a model, "
+              << "skipping\n";
+            continue;
+          }
+
+          loaded = loadedModels.emplace(uri, *(root.Model())).first;
+          loaded->second.SetUri(uri);
+        }
 
-        model = *(root.Model());
-        model.SetUri(uri);
+        model = loaded->second;
       }
       else
       {
@@ -186,6 +1480,14 @@ void Scenario::Implementation::LoadConfiguration(const YAML::Node &_config)
     }
   }
 
+  // Read server configuration, if present.
+  if (_config["server"])
+  {
+    YAML::Node serverNode = _config["server"];
+    if (serverNode["reuse"])
+      this->reuseServer = serverNode["reuse"].as<bool>();
+  }
+
   // Read log record configuration, if present.
   if (_config["record"])
   {
@@ -194,6 +1496,41 @@ void Scenario::Implementation::LoadConfiguration(const YAML::Node &_config)
       this->recordSimState = recordNode["sim-state"].as<bool>();
   }
 
+  // Each test records its sim state to its own log, and a server can't
+  // switch logs, so recording tests can't reuse a server.
+  if (this->reuseServer && this->recordSimState && !this->baseLogPath.empty())
+  {
+    gzwarn << "Server reuse is disabled, since each test records its sim "
+      << "state to its own log. Set record: sim-state: false to reuse "
+      << "servers.\n";
+    this->reuseServer = false;
+  }
+
+  // Read the fail-fast policy, if present.
+  if (_config["fail-fast"])
+  {
+    std::string policy =
+      common::lowercase(_config["fail-fast"].as<std::string>());
+    if (policy == "none" || policy == "false")
+      this->failFast = FailFast::NONE;
+    else if (policy == "test" || policy == "true")
+      this->failFast = FailFast::TEST;
+    else if (policy == "scenario")
+      this->failFast = FailFast::SCENARIO;
+    else
+      gzerr << "Invalid fail-fast[" << policy << "], using none\n";
+  }
+
+  // Read early stop configuration, if present.
+  if (_config["early-stop"])
+  {
+    SequentialTest sequentialTest;
+    if (sequentialTest.Load(_config["early-stop"]))
+      this->earlyStop = sequentialTest;
+    else
+      gzerr << "Invalid early-stop, running all iterations\n";
+  }
+
   if (_config["parameters"])
   {
     for (YAML::const_iterator it = _config["parameters"].begin();
@@ -209,6 +1546,53 @@ void Scenario::Implementation::LoadConfiguration(const YAML::Node &_config)
     }
   }
 
+  std::set<std::string> integers;
+  for (const std::pair<const std::string, Param> &param : this->parameters)
+  {
+    std::string type = common::lowercase(param.second.type);
+    if (type == "int" || type == "integer")
+      integers.insert(param.first);
+  }
+
+  // A search adds an iteration for every value it probes.
+  if (_config["search"])
+  {
+    ParameterSearch parameterSearch;
+    if (parameterSearch.Load(_config["search"], integers))
+    {
+      if (_config["iterations"] || _config["sweep"])
+        gzwarn << "Scenario has a search, ignoring its iterations\n";
+      if (this->earlyStop)
+        gzwarn << "Early stopping is not used by searches\n";
+
+      // Every probe is expected to fail on one side of the boundary.
+      if (this->failFast == FailFast::SCENARIO)
+      {
+        gzwarn << "Searches don't abort on failure, using the test "
+          << "fail-fast policy\n";
+        this->failFast = FailFast::TEST;
+      }
+      this->earlyStop.reset();
+      this->search = parameterSearch;
+      return;
+    }
+    gzerr << "Invalid search, using the scenario's iterations\n";
+  }
+
+  // A sweep generates the iterations as they are run.
+  if (_config["sweep"])
+  {
+    ParameterSweep parameterSweep;
+    if (parameterSweep.Load(_config["sweep"], integers))
+    {
+      if (_config["iterations"])
+        gzwarn << "Scenario has a sweep, ignoring its iterations\n";
+      this->sweep = parameterSweep;
+      return;
+    }
+    gzerr << "Invalid sweep, using the scenario's iterations\n";
+  }
+
   if (_config["iterations"])
   {
     for (YAML::const_iterator it = _config["iterations"].begin();
@@ -271,21 +1655,72 @@ bool Scenario::Load(const std::string &_filename,
   if (config["description"])
     this->dataPtr->description = config["description"].as<std::string>();
 
+  // \todo I shouldn't have to call this function. The sim::Server's
+  // constructor calls this function, but it's probably not suitable when
+  // Gazebo is used a library.
+  sdf::setFindCallback(std::bind(&ResourceCache::FetchResource,
+        &this->dataPtr->cache, std::placeholders::_1));
+
   // Load the configuration section of the scenario
   if (config["configuration"])
     this->dataPtr->LoadConfiguration(config["configuration"]);
 
-  // Load the yaml strings for all the tests
+  // Each parallel test runs in its own worker process, with its own
+  // Gazebo Transport partition. The iterations of a search are only
+  // known while it runs, so they can't be handed to worker processes.
+  if (this->dataPtr->search && this->dataPtr->jobs > 1)
+  {
+    gzerr << "Parameter searches run one test at a time, "
+      << "use a single job\n";
+    return false;
+  }
+
+  // Resolve Fuel URIs found by the servers, such as meshes, through the
+  // cache as well. Callbacks are tried in the order they are added, so
+  // this one comes before those added by each sim::Server. It can't be
+  // removed, so it holds its own copy of the cache.
+  common::addFindFileURICallback(
+      [cache = this->dataPtr->cache](const common::URI &_uri) mutable
+      {
+        if (_uri.Scheme() != "http" && _uri.Scheme() != "https")
+          return std::string();
+        return cache.FetchResource(_uri.Str());
+      });
+
+  // Locate the parameter placeholders of all the tests once.
   for (YAML::const_iterator it = config["tests"].begin();
        it != config["tests"].end(); ++it)
   {
-    std::ostringstream stream;
-    stream << *it;
-    this->dataPtr->testYaml.push_back(stream.str());
+    this->dataPtr->testTemplates.emplace_back(*it);
   }
 
-  std::string worldFilePath = sim::resolveSdfWorldFile(
-      this->dataPtr->worldFilename);
+  // Fuel worlds are resolved through the cache, so that offline mode
+  // applies to them. Their directory contains a single SDF file.
+  std::string worldFilePath;
+  common::URI worldUri(this->dataPtr->worldFilename);
+  if (worldUri.Scheme() == "http" || worldUri.Scheme() == "https")
+  {
+    namespace fs = std::filesystem;
+    std::string worldDir = this->dataPtr->cache.FetchResource(
+        this->dataPtr->worldFilename);
+    std::error_code ec;
+    if (!worldDir.empty() && fs::is_directory(worldDir, ec))
+    {
+      for (const fs::directory_entry &entry :
+           fs::directory_iterator(worldDir, ec))
+      {
+        if (entry.path().extension() == ".sdf")
+        {
+          worldFilePath = entry.path().string();
+          break;
+        }
+      }
+    }
+  }
+  else
+  {
+    worldFilePath = sim::resolveSdfWorldFile(this->dataPtr->worldFilename);
+  }
   if (worldFilePath.empty())
   {
     gzerr << "Unable to find world file ["
@@ -294,14 +1729,8 @@ bool Scenario::Load(const std::string &_filename,
   }
   igndbg << "Resolved world file path[" << worldFilePath << "]\n";
 
-  // \todo I shouldn't have to call this function. The sim::Server's
-  // constructor calls this function, but it's probably not suitable when
-  // Gazebo is used a library.
-  sdf::setFindCallback(
-      std::bind(fuel_tools::fetchResource, std::placeholders::_1));
-
   sdf::Root root;
-  sdf::Errors errors = root.Load(worldFilePath);
+  sdf::Errors errors = this->dataPtr->cache.LoadSdf(worldFilePath, root);
   if (!errors.empty())
   {
     gzerr << "Failed to load SDF world file[" << worldFilePath << "]\n";
@@ -311,6 +1740,19 @@ bool Scenario::Load(const std::string &_filename,
     return false;
   }
 
+  this->dataPtr->worldName = root.WorldByIndex(0)->Name();
+
+  // Get the physics step size. SDF uses a default of 1ms.
+  const sdf::Physics *physics = root.WorldByIndex(0)->PhysicsDefault();
+  if (physics && physics->MaxStepSize() > 0)
+  {
+    this->dataPtr->stepSize =
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(physics->MaxStepSize()));
+  }
+  igndbg << "Physics step size[" << this->dataPtr->stepSize.count()
+    << "ns]\n";
+
   // Add the models to the world.
   for (sdf::Model model : this->dataPtr->models)
     root.WorldByIndex(0)->AddModel(model);
@@ -324,9 +1766,28 @@ bool Scenario::Load(const std::string &_filename,
   return true;
 }
 
+//////////////////////////////////////////////////
+void Scenario::SetCachePath(const std::string &_path)
+{
+  this->dataPtr->cache.SetPath(_path);
+}
+
+//////////////////////////////////////////////////
+void Scenario::SetOffline(bool _offline)
+{
+  this->dataPtr->cache.SetOffline(_offline);
+}
+
 //////////////////////////////////////////////////
 void Scenario::Run()
 {
+  if (this->dataPtr->search && this->dataPtr->jobs > 1)
+  {
+    gzerr << "Parameter searches run one test at a time, "
+      << "use a single job\n";
+    return;
+  }
+
   this->dataPtr->run = true;
   std::pair<int64_t, int64_t> timePair;
 
@@ -334,6 +1795,10 @@ void Scenario::Run()
   result.set_name(this->Name());
   result.set_description(this->Description());
 
+  // Record the seed, so that the iterations can be reproduced.
+  if (this->dataPtr->sweep && this->dataPtr->sweep->Random())
+    result.set_sweep_seed(this->dataPtr->sweep->Seed());
+
   // Start a stop watch to record the duration of the run.
   math::Stopwatch watch;
   watch.Start();
@@ -348,142 +1813,147 @@ void Scenario::Run()
   int scenarioIterationFailCount = 0;
   int scenarioIterationTotalCount = 0;
 
-  math::Stopwatch iterationWatch, testWatch;
-  // Run each iteration
-  for (this->dataPtr->iteration= 0;
-       this->dataPtr->iteration < this->dataPtr->iterations.size();
-       ++this->dataPtr->iteration)
+  // Each test result is appended to a stream as soon as the test
+  // finishes, so that the results of finished tests survive a crash, and
+  // are not kept in memory while the remaining tests run.
+  std::string streamFilename;
+  if (!this->dataPtr->baseLogPath.empty() &&
+      common::isDirectory(this->dataPtr->baseLogPath))
   {
-    igndbg << "Running test iteration " << this->dataPtr->iteration << "\n";
-
-    domain::Iteration *iterationResult = result.add_iterations();
+    streamFilename =
+      common::joinPaths(this->dataPtr->baseLogPath, "results.pb");
+    std::string jsonFilename = this->dataPtr->streamJson ?
+      common::joinPaths(this->dataPtr->baseLogPath, "results.jsonl") : "";
+    if (!this->dataPtr->resultWriter.Open(streamFilename, jsonFilename))
+      streamFilename.clear();
+  }
 
-    int iterationTestFailCount = 0;
-    int iterationTestCount = 0;
+  // Every test of every iteration is an independent task. Results are
+  // merged in task order once all tasks are complete, so the result does
+  // not depend on how the tasks were run.
+  std::vector<Implementation::Task> unstreamed;
 
-    timePair = timePointToSecNsec(std::chrono::system_clock::now());
-    iterationResult->mutable_start_time()->set_seconds(timePair.first);
-    iterationResult->mutable_start_time()->set_nanos(timePair.second);
-    iterationWatch.Start(true);
+  // The number of tests of a search is unknown until it ends.
+  this->dataPtr->StartProgress("", this->dataPtr->search ? 0 :
+      static_cast<int>(this->dataPtr->TaskCount()));
+  if (this->dataPtr->search)
+  {
+    if (this->dataPtr->processes > 1)
+      gzwarn << "Searches run in a single process\n";
+    this->dataPtr->RunSearch(unstreamed);
+  }
+  else if (this->dataPtr->processes > 1 || this->dataPtr->jobs > 1)
+  {
+    this->dataPtr->RunProcesses(unstreamed);
+  }
+  else
+  {
+    this->dataPtr->RunTasks(unstreamed, 0, this->dataPtr->TaskCount());
+  }
+  this->dataPtr->StopProgress();
 
-    // Create the tests.
-    this->dataPtr->tests.clear();
-    for (std::string yamlStr : this->dataPtr->testYaml)
-    {
-      for (const std::pair<const std::string, Implementation::Param> &param :
-          this->dataPtr->iterations.at(this->dataPtr->iteration))
-      {
-        (*iterationResult->mutable_params())[param.first] =
-          param.second.value;
-        yamlStr = std::regex_replace(yamlStr,
-            std::regex("\\$\\{\\{" + param.first +"\\}\\}"),
-            param.second.value);
-      }
+  // Merge the results of each iteration, in order. Records are read one
+  // at a time and only kept until their iteration is complete, which they
+  // mostly are when read, since tasks run roughly in order. Iterations
+  // that never started have no records, and are skipped.
+  auto mergeIteration = [&](std::vector<domain::Record> &_records)
+  {
+    std::sort(_records.begin(), _records.end(),
+        [](const domain::Record &_a, const domain::Record &_b)
+        {
+          return _a.test_index() < _b.test_index();
+        });
 
-      YAML::Node parsedNode = YAML::Load(yamlStr);
+    domain::Iteration *iterationResult = result.add_iterations();
+    *iterationResult->mutable_params() = _records.front().params();
 
-      std::shared_ptr<Test> test = std::make_shared<Test>();
-      test->Load(parsedNode);
-      this->dataPtr->tests.push_back(std::move(test));
-    }
+    int iterationTestFailCount = 0;
+    int iterationTestCount = 0;
+    std::chrono::system_clock::time_point iterationStart =
+      std::chrono::system_clock::time_point::max();
+    std::chrono::system_clock::time_point iterationEnd =
+      std::chrono::system_clock::time_point::min();
 
-    // Run each test
-    for (std::vector<std::shared_ptr<Test>>::iterator it =
-        this->dataPtr->tests.begin();
-        it != this->dataPtr->tests.end() && this->dataPtr->run; ++it)
+    for (domain::Record &record : _records)
     {
-      testWatch.Start(true);
-
-      igndbg << "Running Test[" << (*it)->Name() << "]\n";
-
-      if (!this->dataPtr->baseLogPath.empty())
+      const domain::Test &testResult = record.test();
+      std::chrono::system_clock::time_point testStart =
+        secNsecToTimePoint(testResult.start_time().seconds(),
+            testResult.start_time().nanos());
+      std::chrono::system_clock::time_point testEnd = testStart +
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(testResult.duration().seconds()) +
+            std::chrono::nanoseconds(testResult.duration().nanos()));
+      iterationStart = std::min(iterationStart, testStart);
+      iterationEnd = std::max(iterationEnd, testEnd);
+
+      // Keep track of the fail count.
+      if (record.ran())
       {
-        this->dataPtr->serverConfig.SetUseLogRecord(
-            this->dataPtr->recordSimState);
-        this->dataPtr->serverConfig.SetLogRecordPath(
-            common::joinPaths(this->dataPtr->baseLogPath, (*it)->Name(),
-              std::to_string(this->dataPtr->iteration)));
-      }
-      else
-      {
-        this->dataPtr->serverConfig.SetUseLogRecord(false);
-      }
-
-      domain::Test *testResult = iterationResult->add_tests();
-      testResult->set_name((*it)->Name());
-      timePair = timePointToSecNsec(std::chrono::system_clock::now());
-      testResult->mutable_start_time()->set_seconds(timePair.first);
-      testResult->mutable_start_time()->set_nanos(timePair.second);
-
-      // HERE: Setup a correct region trigger.
-      //       Capture console logs
-      //       A trigger can trigger anohter trigger.
-      //       Build and release docker image.
-      //       Update ci-test repo so that multiple tests are triggered.
-      //       Capture robot trajectory.
-      //       Plot robot trajectory in browswer and show changes over time.
-
-      bool beforeScriptSuccessful =
-        this->dataPtr->processManager.RunExecutablesAsBash(
-            this->dataPtr->beforeScript);
-
-      if (beforeScriptSuccessful)
-      {
-        this->dataPtr->server =
-          std::make_unique<sim::Server>(this->dataPtr->serverConfig);
-
-        this->dataPtr->server->AddSystem((*it));
-
-        // \todo I think a behavior tree, or state machine would serve us
-        // better here.
-        std::function<void()> stopCb = [&]() {
-          this->dataPtr->server->Stop();
-        };
-        (*it)->SetStopCallback(stopCb);
-
-        // \todo Support Running simulation with a simulation or
-        // real time limit.
-        if ((*it)->MaxDurationType() == TimeType::REAL)
-          gzerr << "Real-time type not supported for time-limit\n";
-        uint64_t iterations = 0;
-        if ((*it)->MaxDuration() > 0s)
-        {
-          std::chrono::steady_clock::duration dt = 10ms;
-          iterations = (*it)->MaxDuration() / dt;
-        }
-
-        this->dataPtr->server->Run(true, iterations, false);
-        testWatch.Stop();
-
-        timePair = math::durationToSecNsec(testWatch.ElapsedRunTime());
-        testResult->mutable_duration()->set_seconds(timePair.first);
-        testResult->mutable_duration()->set_nanos(timePair.second);
-
-        // Fill results, and keep track of the fail count.
-        if (!(*it)->FillResults(testResult))
+        if (testResult.failed())
           iterationTestFailCount++;
         iterationTestCount++;
-
-        this->dataPtr->server.reset();
       }
+
+      iterationResult->mutable_tests()->AddAllocated(record.release_test());
     }
 
+    timePair = timePointToSecNsec(iterationStart);
+    iterationResult->mutable_start_time()->set_seconds(timePair.first);
+    iterationResult->mutable_start_time()->set_nanos(timePair.second);
+    timePair = math::durationToSecNsec(iterationEnd - iterationStart);
+    iterationResult->mutable_duration()->set_seconds(timePair.first);
+    iterationResult->mutable_duration()->set_nanos(timePair.second);
+
     iterationResult->set_failed(iterationTestFailCount > 0);
     iterationResult->set_test_fail_count(iterationTestFailCount);
     iterationResult->set_test_count(iterationTestCount);
 
-
-    iterationWatch.Stop();
-    timePair = math::durationToSecNsec(iterationWatch.ElapsedRunTime());
-    iterationResult->mutable_duration()->set_seconds(timePair.first);
-    iterationResult->mutable_duration()->set_nanos(timePair.second);
-
     scenarioTotalFailCount += iterationTestFailCount;
     scenarioTotalCount += iterationTestCount;
 
     scenarioIterationFailCount += iterationTestFailCount > 0 ? 1 : 0;
     scenarioIterationTotalCount++;
+  };
+
+  // Records of the iterations that can't be merged yet, by iteration.
+  std::map<int32_t, std::vector<domain::Record>> pending;
+  int32_t nextIteration = 0;
+  const size_t testCount = this->dataPtr->testTemplates.size();
+  auto addRecord = [&](domain::Record &&_record)
+  {
+    pending[_record.iteration()].push_back(std::move(_record));
+    while (!pending.empty() && pending.begin()->first <= nextIteration &&
+           pending.begin()->second.size() >= testCount)
+    {
+      mergeIteration(pending.begin()->second);
+      nextIteration = pending.begin()->first + 1;
+      pending.erase(pending.begin());
+    }
+  };
+
+  // Read the records from the stream, and the results that could not be
+  // streamed.
+  if (!streamFilename.empty())
+  {
+    this->dataPtr->resultWriter.Close();
+    ResultWriter::Read(streamFilename, [&](domain::Record &_record)
+        {
+          addRecord(std::move(_record));
+        });
   }
+  for (Implementation::Task &task : unstreamed)
+  {
+    if (task.result)
+      addRecord(this->dataPtr->CreateRecord(task));
+  }
+  unstreamed.clear();
+
+  // Merge the iterations with missing records, such as those stopped by
+  // a fail-fast abort.
+  for (auto &entry : pending)
+    mergeIteration(entry.second);
+  pending.clear();
   watch.Stop();
 
   timePair = math::durationToSecNsec(watch.ElapsedRunTime());
@@ -497,21 +1967,151 @@ void Scenario::Run()
   result.set_iteration_fail_count(scenarioIterationFailCount);
   result.set_failed(scenarioTotalFailCount > 0);
 
+  if (this->dataPtr->earlyStop)
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->earlyStopMutex);
+    this->dataPtr->earlyStop->FillResults(result.mutable_sequential_test());
+    result.mutable_sequential_test()->set_stopped_early(
+        this->dataPtr->stoppedEarly);
+  }
+
+  if (this->dataPtr->search)
+    this->dataPtr->search->FillResults(result.mutable_parameter_search());
+
+  result.set_aborted(this->dataPtr->aborted);
+
+  std::string extension = "pbtxt";
+  if (this->dataPtr->resultFormat == ResultFormat::BINARY)
+    extension = "pb";
+  else if (this->dataPtr->resultFormat == ResultFormat::JSON)
+    extension = "json";
+
+  std::ofstream file;
   if (!this->dataPtr->baseLogPath.empty() &&
       common::isDirectory(this->dataPtr->baseLogPath))
   {
     std::string resultFilename =
-      common::joinPaths(this->dataPtr->baseLogPath, "result.pbtxt");
+      common::joinPaths(this->dataPtr->baseLogPath, "result." + extension);
+    file.open(resultFilename, std::ofstream::out | std::ofstream::binary);
+  }
+  std::ostream &stream = file.is_open() ? file : std::cout;
 
-    std::ofstream stream;
-    stream.open(resultFilename, std::ofstream::out);
-    stream << result.DebugString() << std::endl;
+  switch (this->dataPtr->resultFormat)
+  {
+    case ResultFormat::BINARY:
+      result.SerializeToOstream(&stream);
+      break;
+    case ResultFormat::JSON:
+    {
+      std::string json;
+      google::protobuf::util::JsonPrintOptions options;
+      options.preserve_proto_field_names = true;
+      google::protobuf::util::MessageToJsonString(result, &json, options);
+      stream << json << std::endl;
+      break;
+    }
+    case ResultFormat::PBTXT:
+    default:
+      stream << result.DebugString() << std::endl;
+      break;
   }
-  else
+}
+
+//////////////////////////////////////////////////
+void Scenario::SetJobs(unsigned int _jobs)
+{
+  this->dataPtr->jobs = _jobs;
+}
+
+//////////////////////////////////////////////////
+void Scenario::SetResultFormat(ResultFormat _format)
+{
+  this->dataPtr->resultFormat = _format;
+}
+
+//////////////////////////////////////////////////
+void Scenario::SetProgressRate(double _rate)
+{
+  this->dataPtr->progressRate = _rate;
+}
+
+//////////////////////////////////////////////////
+void Scenario::SetStreamJson(bool _json)
+{
+  this->dataPtr->streamJson = _json;
+}
+
+//////////////////////////////////////////////////
+void Scenario::SetProcesses(unsigned int _processes,
+    const std::vector<std::string> &_workerCmd)
+{
+  this->dataPtr->processes = _processes;
+  this->dataPtr->workerCmd = _workerCmd;
+}
+
+//////////////////////////////////////////////////
+void Scenario::RunWorker(const std::string &_workDir, unsigned int _id)
+{
+  namespace fs = std::filesystem;
+
+  this->dataPtr->run = true;
+
+  // The worker's partition is set in its environment by the coordinator,
+  // along with the partition to publish progress in.
+  std::string progressPartition;
+  common::env("GZ_TEST_PROGRESS_PARTITION", progressPartition);
+  this->dataPtr->StartProgress(progressPartition,
+      static_cast<int>(this->dataPtr->TaskCount()));
+
+  // The worker runs one test at a time, so that its servers only ever
+  // see the partition it was launched with.
+  Implementation::ServerSlot slot;
+  while (this->dataPtr->run)
   {
-    std::cout << result.DebugString() << std::endl;
+    std::optional<size_t> index = this->dataPtr->ClaimTask(_workDir);
+    if (!index || *index >= this->dataPtr->TaskCount())
+      break;
+    igndbg << "Worker " << _id << " claimed task " << *index << "\n";
+
+    Implementation::Task task = this->dataPtr->CreateTask(*index);
+    this->dataPtr->RunTask(task, slot);
+    if (!task.result)
+      continue;
+
+    // Each result is a single record, which the coordinator appends to
+    // the scenario's results stream.
+    domain::Record record = this->dataPtr->CreateRecord(task);
+
+    // Write to a temporary file first, so that the coordinator never
+    // reads a partial result.
+    fs::path resultPath = fs::path(_workDir) / "results" /
+      (std::to_string(*index) + ".pb");
+    fs::path tmpPath = resultPath;
+    tmpPath += ".tmp";
+    bool failed = task.ran && record.test().failed();
+    ResultWriter writer;
+    if (writer.Open(tmpPath.string()) && writer.Write(record))
+    {
+      writer.Close();
+      std::error_code ec;
+      fs::rename(tmpPath, resultPath, ec);
+      fs::remove(fs::path(_workDir) / "running" / std::to_string(*index),
+          ec);
+    }
+
+    // Aborting stops all workers from claiming tasks, and tells the
+    // coordinator that the scenario was aborted.
+    if (this->dataPtr->AbortIfFailed(failed))
+    {
+      std::ofstream(fs::path(_workDir) / "aborted");
+      updateTickets(_workDir, [](size_t &_next, size_t &_end)
+          {
+            _end = std::min(_end, _next);
+          });
+    }
   }
 
+  this->dataPtr->StopProgress();
 }
 
 //////////////////////////////////////////////////
@@ -608,12 +2208,16 @@ void Scenario::Implementation::OnSigIntTerm(int)
   this->run = false;
   igndbg << "SigInt handler triggered\n";
 
-  // Stop the server
-  if (this->server)
-    this->server->Stop();
+  {
+    std::lock_guard<std::mutex> lock(this->runningMutex);
+
+    // Stop the servers
+    for (sim::Server *server : this->servers)
+      server->Stop();
 
-  // Stop the tests
-  for (std::shared_ptr<Test> &test : this->tests)
-    test->Stop();
+    // Stop the tests
+    for (std::shared_ptr<Test> &test : this->tests)
+      test->Stop();
+  }
   this->processManager.Stop();
 }
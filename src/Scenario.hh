@@ -31,9 +31,33 @@ namespace gz
     inline namespace GZ_TEST_VERSION_NAMESPACE {
     class Scenario
     {
+      /// \brief Format of the scenario result file.
+      public: enum class ResultFormat
+      {
+        /// \brief Protobuf text format, in result.pbtxt.
+        PBTXT,
+
+        /// \brief Protobuf binary format, in result.pb.
+        BINARY,
+
+        /// \brief JSON, in result.json.
+        JSON
+      };
+
       /// \brief Default constructor.
       public: Scenario();
 
+      /// \brief Set the directory used to cache resolved resources across
+      /// runs. Must be called before Load.
+      /// \param[in] _path Path to the cache directory.
+      public: void SetCachePath(const std::string &_path);
+
+      /// \brief Set whether resources may be fetched from the network.
+      /// In offline mode, resources are only resolved from the cache.
+      /// Must be called before Load.
+      /// \param[in] _offline True to never use the network.
+      public: void SetOffline(bool _offline);
+
       /// \brief Load a scenario file.
       /// \param[in] _filename The scenario filename
       /// \return True if the file was loaded successfully.
@@ -91,6 +115,51 @@ namespace gz
       /// \param[in] _config The server configuration.
       public: void SetServerConfig(const sim::ServerConfig &_config);
 
+      /// \brief Set the number of tests to run in parallel. Each parallel
+      /// test runs in its own worker process, with its own Gazebo
+      /// Transport partition, since Gazebo Transport only reads the
+      /// partition from the process environment. Parameter searches run
+      /// one test at a time, and fail to load or run with more than one
+      /// job. Must be called before Load. The default is one.
+      /// \param[in] _jobs Number of tests to run in parallel.
+      public: void SetJobs(unsigned int _jobs);
+
+      /// \brief Set the format of the scenario result. The result is
+      /// written to the output path, or to standard output if there is no
+      /// output path. The default is ResultFormat::PBTXT.
+      /// \param[in] _format The result format.
+      public: void SetResultFormat(ResultFormat _format);
+
+      /// \brief Set whether each test result is also streamed as a line of
+      /// JSON to results.jsonl in the output path, alongside the binary
+      /// results.pb stream.
+      /// \param[in] _json True to stream JSON lines.
+      public: void SetStreamJson(bool _json);
+
+      /// \brief Set the rate at which the progress of running tests is
+      /// published on the /test/progress topic, as domain::Progress
+      /// messages. The default is 1 Hz.
+      /// \param[in] _rate Rate in Hz, or zero to disable progress.
+      public: void SetProgressRate(double _rate);
+
+      /// \brief Set the number of worker processes. When more than one
+      /// process or job is used, the tests are sharded across as many
+      /// worker processes as processes times jobs, each launched with
+      /// _workerCmd followed by the "--worker-dir" and "--worker-id"
+      /// arguments, and this process merges their results.
+      /// \param[in] _processes Number of worker processes.
+      /// \param[in] _workerCmd Command, with arguments, that runs this
+      /// scenario.
+      public: void SetProcesses(unsigned int _processes,
+                  const std::vector<std::string> &_workerCmd);
+
+      /// \brief Run tests as a worker process, one at a time, until no
+      /// tests are left in the work directory.
+      /// \param[in] _workDir The work directory shared with the
+      /// coordinating process.
+      /// \param[in] _id Id of this worker.
+      public: void RunWorker(const std::string &_workDir, unsigned int _id);
+
       public: void SendRecordingCompleteMessage();
 
       public: void SendFinishedMessage();
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <cmath>
+
+#include <gz/math/Helpers.hh>
+
+#include <gz/common/Console.hh>
+#include <gz/common/StringUtils.hh>
+
+#include "SequentialTest.hh"
+
+using namespace gz;
+using namespace test;
+
+namespace
+{
+  //////////////////////////////////////////////////
+  /// \brief Probability that a binomial variable is at least, or at
+  /// most, a number of successes that is on the far side of the mean.
+  /// Terms are summed away from the mean, where they keep decreasing,
+  /// and the sum stops once they no longer change it. This is much
+  /// cheaper than summing the whole tail when it is far from the mean.
+  /// \param[in] _n Number of trials.
+  /// \param[in] _p Success probability.
+  /// \param[in] _k Number of successes.
+  /// \param[in] _upper True for P(X >= _k), false for P(X <= _k).
+  /// \return The tail probability.
+  double binomialTail(uint64_t _n, double _p, uint64_t _k, bool _upper)
+  {
+    const double n = static_cast<double>(_n);
+    const double k = static_cast<double>(_k);
+    double term = std::exp(std::lgamma(n + 1) - std::lgamma(k + 1) -
+        std::lgamma(n - k + 1) + k * std::log(_p) +
+        (n - k) * std::log1p(-_p));
+    double sum = term;
+    const double odds = _p / (1.0 - _p);
+    if (_upper)
+    {
+      for (uint64_t j = _k; j < _n && term > sum * 1e-17; ++j)
+      {
+        term *= static_cast<double>(_n - j) / static_cast<double>(j + 1) *
+          odds;
+        sum += term;
+      }
+    }
+    else
+    {
+      for (uint64_t j = _k; j > 0 && term > sum * 1e-17; --j)
+      {
+        term *= static_cast<double>(j) / static_cast<double>(_n - j + 1) /
+          odds;
+        sum += term;
+      }
+    }
+    return std::min(sum, 1.0);
+  }
+}
+
+/////////////////////////////////////////////////
+bool SequentialTest::Load(const YAML::Node &_node)
+{
+  if (_node["method"])
+  {
+    std::string methodStr =
+      common::lowercase(_node["method"].as<std::string>());
+    if (methodStr == "sprt")
+      this->method = domain::SequentialTest::SPRT;
+    else if (methodStr == "confidence-interval")
+      this->method = domain::SequentialTest::CONFIDENCE_INTERVAL;
+    else
+    {
+      gzerr << "Unknown early stop method[" << methodStr << "]\n";
+      return false;
+    }
+  }
+
+  if (_node["pass-rate"])
+    this->passRate = _node["pass-rate"].as<double>();
+  if (_node["confidence"])
+    this->confidence = _node["confidence"].as<double>();
+  if (_node["indifference"])
+    this->indifference = _node["indifference"].as<double>();
+  if (_node["min-iterations"])
+    this->minIterations = _node["min-iterations"].as<uint64_t>();
+
+  if (this->passRate <= 0 || this->passRate >= 1)
+  {
+    gzerr << "Early stop pass-rate must be between 0 and 1\n";
+    return false;
+  }
+  if (this->confidence <= 0.5 || this->confidence >= 1)
+  {
+    gzerr << "Early stop confidence must be between 0.5 and 1\n";
+    return false;
+  }
+  if (this->indifference <= 0)
+  {
+    gzerr << "Early stop indifference must be positive\n";
+    return false;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool SequentialTest::Add(bool _passed)
+{
+  if (_passed)
+    this->passCount++;
+  else
+    this->failCount++;
+
+  if (this->Decided())
+    return false;
+
+  this->decision = this->Decide();
+  return this->Decided();
+}
+
+/////////////////////////////////////////////////
+bool SequentialTest::Decided() const
+{
+  return this->decision != domain::SequentialTest::UNDECIDED;
+}
+
+/////////////////////////////////////////////////
+domain::SequentialTest::Decision SequentialTest::Decide() const
+{
+  const double n = static_cast<double>(this->passCount + this->failCount);
+  if (n < static_cast<double>(std::max<uint64_t>(this->minIterations, 1)))
+    return domain::SequentialTest::UNDECIDED;
+
+  if (this->method == domain::SequentialTest::SPRT)
+  {
+    const double error = 1.0 - this->confidence;
+    const double llr = this->LogLikelihoodRatio();
+    if (llr >= std::log((1.0 - error) / error))
+      return domain::SequentialTest::PASSING;
+    if (llr <= std::log(error / (1.0 - error)))
+      return domain::SequentialTest::FAILING;
+    return domain::SequentialTest::UNDECIDED;
+  }
+
+  // The one-sided exact (Clopper-Pearson) confidence bound of the pass
+  // rate excludes the threshold when the binomial test rejects it. The
+  // confidence is corrected for the number of looks, so checking after
+  // every iteration doesn't inflate the error rate.
+  if (this->Confidence() < this->confidence)
+    return domain::SequentialTest::UNDECIDED;
+  return static_cast<double>(this->passCount) / n >= this->passRate ?
+    domain::SequentialTest::PASSING : domain::SequentialTest::FAILING;
+}
+
+/////////////////////////////////////////////////
+double SequentialTest::LogLikelihoodRatio() const
+{
+  const double high = std::min(this->passRate + this->indifference, 0.999);
+  const double low = std::max(this->passRate - this->indifference, 0.001);
+  return static_cast<double>(this->passCount) * std::log(high / low) +
+    static_cast<double>(this->failCount) *
+    std::log((1.0 - high) / (1.0 - low));
+}
+
+/////////////////////////////////////////////////
+double SequentialTest::Confidence() const
+{
+  const uint64_t n = this->passCount + this->failCount;
+  if (n == 0)
+    return 0;
+
+  // The likelihood ratio is a martingale under the hypothesis it argues
+  // against, so by Ville's inequality the probability that it ever
+  // reaches exp(|llr|) is at most exp(-|llr|), wherever the test stops.
+  if (this->method == domain::SequentialTest::SPRT)
+    return 1.0 - std::min(std::exp(-std::abs(this->LogLikelihoodRatio())),
+        1.0);
+
+  // One minus the p-value of the exact binomial test against the
+  // threshold, on the side of the threshold that the pass rate is on.
+  double pValue = static_cast<double>(this->passCount) /
+    static_cast<double>(n) >= this->passRate ?
+    binomialTail(n, this->passRate, this->passCount, true) :
+    binomialTail(n, this->passRate, this->passCount, false);
+
+  // The test is repeated after every iteration, from the first allowed
+  // decision on. Look k spends 6 / (pi^2 k^2) of the error rate, which
+  // sums to the whole error rate over any number of looks, so the
+  // confidence holds wherever the test stops.
+  const uint64_t firstLook = std::max<uint64_t>(this->minIterations, 1);
+  const double look =
+    static_cast<double>(n >= firstLook ? n - firstLook + 1 : 1);
+  pValue *= GZ_PI * GZ_PI * look * look / 6.0;
+  return 1.0 - std::min(pValue, 1.0);
+}
+
+/////////////////////////////////////////////////
+void SequentialTest::FillResults(domain::SequentialTest *_msg) const
+{
+  _msg->set_method(this->method);
+  _msg->set_pass_rate(this->passRate);
+  _msg->set_target_confidence(this->confidence);
+  _msg->set_decision(this->decision);
+  _msg->set_pass_count(static_cast<int32_t>(this->passCount));
+  _msg->set_fail_count(static_cast<int32_t>(this->failCount));
+  _msg->set_confidence(this->Confidence());
+}
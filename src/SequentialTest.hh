@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_SEQUENTIALTEST_HH_
+#define GZ_TEST_SEQUENTIALTEST_HH_
+
+#include <yaml-cpp/yaml.h>
+
+#include <cstdint>
+
+#include "gz/test/config.hh"
+#include "msgs/scenario.pb.h"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief Decides whether the pass rate of a sequence of iterations is
+    /// above a threshold, as soon as the outcomes seen so far are enough
+    /// to decide at a given confidence.
+    ///
+    /// Two methods are supported:
+    ///   * confidence-interval: Decide once the one-sided exact
+    ///     (Clopper-Pearson) confidence bound of the pass rate is above or
+    ///     below the threshold. The bound is corrected for being checked
+    ///     after every iteration, with a union bound over the looks.
+    ///   * sprt: Wald's sequential probability ratio test between the pass
+    ///     rates threshold + indifference and threshold - indifference,
+    ///     with both error rates equal to 1 - confidence.
+    class SequentialTest
+    {
+      /// \brief Load the test configuration.
+      /// \param[in] _node The YAML node of the configuration.
+      /// \return True if the configuration is valid.
+      public: bool Load(const YAML::Node &_node);
+
+      /// \brief Add the outcome of an iteration. Outcomes added after the
+      /// test is decided are counted, but don't change the decision.
+      /// \param[in] _passed True if the iteration passed.
+      /// \return True if this outcome decided the test.
+      public: bool Add(bool _passed);
+
+      /// \brief Get whether the test is decided.
+      /// \return True if the test is decided.
+      public: bool Decided() const;
+
+      /// \brief Get the achieved confidence that the pass rate is on the
+      /// observed side of the threshold. With the confidence-interval
+      /// method, this is from a one-sided exact binomial test corrected
+      /// for the number of looks. With the SPRT, this is one minus the
+      /// bound exp(-|log likelihood ratio|) on the probability of the
+      /// opposite hypothesis reaching the observed likelihood ratio, which
+      /// at a decision is at least 1 - (1 - confidence) / confidence.
+      /// \return The confidence, between 0 and 1.
+      public: double Confidence() const;
+
+      /// \brief Fill in a message with the state of the test.
+      /// \param[in] _msg The message to populate.
+      public: void FillResults(domain::SequentialTest *_msg) const;
+
+      /// \brief Get the SPRT log likelihood ratio of the outcomes seen so
+      /// far, of the pass rate threshold + indifference against
+      /// threshold - indifference.
+      /// \return The log likelihood ratio.
+      private: double LogLikelihoodRatio() const;
+
+      /// \brief Make a decision from the outcomes seen so far.
+      /// \return The decision.
+      private: domain::SequentialTest::Decision Decide() const;
+
+      /// \brief Statistical method.
+      private: domain::SequentialTest::Method method{
+                 domain::SequentialTest::CONFIDENCE_INTERVAL};
+
+      /// \brief Pass rate threshold.
+      private: double passRate{0.9};
+
+      /// \brief Confidence required to decide.
+      private: double confidence{0.95};
+
+      /// \brief Half width of the SPRT indifference region.
+      private: double indifference{0.05};
+
+      /// \brief Minimum number of iterations before deciding.
+      private: uint64_t minIterations{0};
+
+      /// \brief Number of iterations that passed.
+      private: uint64_t passCount{0};
+
+      /// \brief Number of iterations that failed.
+      private: uint64_t failCount{0};
+
+      /// \brief The decision.
+      private: domain::SequentialTest::Decision decision{
+                 domain::SequentialTest::UNDECIDED};
+    };
+    }
+  }
+}
+#endif
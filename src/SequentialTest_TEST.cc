@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include <cstdint>
+#include <functional>
+
+#include "SequentialTest.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+/// \brief Add outcomes to a sequential test until it is decided.
+/// \param[in] _test The sequential test.
+/// \param[in] _passed Outcome of an iteration, by index.
+/// \param[in] _max Maximum number of outcomes to add.
+/// \return Number of outcomes added when the test was decided, or zero if
+/// it wasn't decided.
+static uint64_t runUntilDecided(SequentialTest &_test,
+    const std::function<bool(uint64_t)> &_passed, uint64_t _max)
+{
+  for (uint64_t i = 0; i < _max; ++i)
+  {
+    if (_test.Add(_passed(i)))
+      return i + 1;
+  }
+  return 0;
+}
+
+/////////////////////////////////////////////////
+/// \brief Load a sequential test from YAML text.
+/// \param[in] _yaml The configuration.
+/// \return The loaded test.
+static SequentialTest load(const std::string &_yaml)
+{
+  SequentialTest test;
+  EXPECT_TRUE(test.Load(YAML::Load(_yaml)));
+  return test;
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, ConfidenceIntervalAllPass)
+{
+  SequentialTest test = load("{pass-rate: 0.9, confidence: 0.95}");
+  EXPECT_EQ(125u, runUntilDecided(test, [](uint64_t) {return true;}, 1000));
+
+  domain::SequentialTest msg;
+  test.FillResults(&msg);
+  EXPECT_EQ(domain::SequentialTest::PASSING, msg.decision());
+  EXPECT_EQ(125, msg.pass_count());
+  EXPECT_EQ(0, msg.fail_count());
+  EXPECT_NEAR(0.9509902823, test.Confidence(), 1e-9);
+
+  // Later outcomes are counted, but don't change the decision.
+  EXPECT_FALSE(test.Add(false));
+  test.FillResults(&msg);
+  EXPECT_EQ(domain::SequentialTest::PASSING, msg.decision());
+  EXPECT_EQ(1, msg.fail_count());
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, ConfidenceIntervalAllFail)
+{
+  SequentialTest test = load("{pass-rate: 0.9, confidence: 0.95}");
+  EXPECT_EQ(3u, runUntilDecided(test, [](uint64_t) {return false;}, 1000));
+
+  domain::SequentialTest msg;
+  test.FillResults(&msg);
+  EXPECT_EQ(domain::SequentialTest::FAILING, msg.decision());
+  EXPECT_NEAR(0.9851955934, test.Confidence(), 1e-9);
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, ConfidenceIntervalMixed)
+{
+  // One failure every 20 iterations is a pass rate of 0.95.
+  SequentialTest passing = load("{pass-rate: 0.9, confidence: 0.95}");
+  EXPECT_EQ(855u, runUntilDecided(passing,
+        [](uint64_t _i) {return _i % 20 != 19;}, 10000));
+  EXPECT_NEAR(0.9506630937, passing.Confidence(), 1e-9);
+
+  // One failure every 2 iterations is a pass rate of 0.5.
+  SequentialTest failing = load("{pass-rate: 0.9, confidence: 0.95}");
+  EXPECT_EQ(16u, runUntilDecided(failing,
+        [](uint64_t _i) {return _i % 2 == 0;}, 10000));
+  EXPECT_NEAR(0.9741756604, failing.Confidence(), 1e-9);
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, ConfidenceIntervalMinIterations)
+{
+  // Fewer looks are corrected for when the first ones are skipped.
+  SequentialTest test =
+    load("{pass-rate: 0.9, confidence: 0.95, min-iterations: 10}");
+  EXPECT_EQ(124u, runUntilDecided(test, [](uint64_t) {return true;}, 1000));
+  EXPECT_NEAR(0.9539090833, test.Confidence(), 1e-9);
+
+  SequentialTest minimum =
+    load("{pass-rate: 0.9, confidence: 0.95, min-iterations: 10}");
+  EXPECT_EQ(10u,
+      runUntilDecided(minimum, [](uint64_t) {return false;}, 1000));
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, ConfidenceIntervalAtThreshold)
+{
+  // A pass rate equal to the threshold is never decided, and the tail
+  // sums stay cheap for many iterations.
+  SequentialTest test = load("{pass-rate: 0.5, confidence: 0.95}");
+  EXPECT_EQ(0u, runUntilDecided(test,
+        [](uint64_t _i) {return _i % 2 == 0;}, 100000));
+  EXPECT_FALSE(test.Decided());
+  EXPECT_LT(test.Confidence(), 0.95);
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, SprtAllPass)
+{
+  SequentialTest test = load(
+      "{method: sprt, pass-rate: 0.9, confidence: 0.95, indifference: 0.05}");
+  EXPECT_EQ(27u, runUntilDecided(test, [](uint64_t) {return true;}, 1000));
+
+  domain::SequentialTest msg;
+  test.FillResults(&msg);
+  EXPECT_EQ(domain::SequentialTest::SPRT, msg.method());
+  EXPECT_EQ(domain::SequentialTest::PASSING, msg.decision());
+
+  // The SPRT reports its own error bound, exp(-27 ln(0.95 / 0.85)).
+  EXPECT_NEAR(0.9503666428, test.Confidence(), 1e-9);
+  EXPECT_DOUBLE_EQ(test.Confidence(), msg.confidence());
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, SprtAllFail)
+{
+  SequentialTest test = load(
+      "{method: sprt, pass-rate: 0.9, confidence: 0.95, indifference: 0.05}");
+  EXPECT_EQ(3u, runUntilDecided(test, [](uint64_t) {return false;}, 1000));
+
+  domain::SequentialTest msg;
+  test.FillResults(&msg);
+  EXPECT_EQ(domain::SequentialTest::FAILING, msg.decision());
+
+  // exp(-3 ln(0.15 / 0.05)) = 1 / 27.
+  EXPECT_NEAR(1.0 - 1.0 / 27.0, test.Confidence(), 1e-12);
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, SprtMinIterations)
+{
+  SequentialTest test = load("{method: sprt, pass-rate: 0.9, "
+      "confidence: 0.95, indifference: 0.05, min-iterations: 5}");
+  EXPECT_EQ(5u, runUntilDecided(test, [](uint64_t) {return false;}, 1000));
+  EXPECT_NEAR(1.0 - 1.0 / 243.0, test.Confidence(), 1e-12);
+}
+
+/////////////////////////////////////////////////
+TEST(SequentialTest, InvalidConfiguration)
+{
+  SequentialTest test;
+  EXPECT_FALSE(test.Load(YAML::Load("{method: bayes}")));
+  EXPECT_FALSE(test.Load(YAML::Load("{pass-rate: 1.0}")));
+  EXPECT_FALSE(test.Load(YAML::Load("{pass-rate: 0.9, confidence: 0.4}")));
+  EXPECT_FALSE(test.Load(YAML::Load(
+          "{confidence: 0.95, indifference: 0}")));
+}
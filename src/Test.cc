@@ -15,6 +15,13 @@
  *
 */
 #include <yaml-cpp/yaml.h>
+#include <unordered_set>
+
+#include <gz/common/Filesystem.hh>
+#include <gz/math/Helpers.hh>
+#include <gz/sim/Util.hh>
+#include <gz/sim/components/Model.hh>
+
 #include "RegionTrigger.hh"
 #include "TimeTrigger.hh"
 #include "Test.hh"
@@ -70,6 +77,9 @@ bool Test::Load(const YAML::Node &_node)
       << "] is missing a time-limit. Unlimited sim time will be used.\n";
   }
 
+  if (_node["fail-fast"])
+    this->failFast = _node["fail-fast"].as<bool>();
+
   // Load all the triggers
   for (YAML::const_iterator it = _node["triggers"].begin();
        it != _node["triggers"].end(); ++it)
@@ -85,6 +95,7 @@ bool Test::Load(const YAML::Node &_node)
     {
       auto trigger = std::make_unique<RegionTrigger>();
       trigger->Load(*it);
+      trigger->regionId = this->regionIndex.Add(trigger->box);
       this->triggers.push_back(std::move(trigger));
     }
   }
@@ -106,6 +117,7 @@ void Test::Configure(
     sim::EventManager &)
 {
   this->world = sim::World(_entity);
+  this->InvalidateEntityCache();
 }
 
 //////////////////////////////////////////////////
@@ -124,11 +136,35 @@ void Test::Update(const sim::UpdateInfo &,
 void Test::PostUpdate(const sim::UpdateInfo &_info,
     const sim::EntityComponentManager &_ecm)
 {
+  // Scoped names may resolve differently once entities are created or
+  // removed. Entities marked for removal are still in the ECM until the
+  // next step, so the cache is invalidated again once they are gone.
+  bool removing = _ecm.HasEntitiesMarkedForRemoval();
+  if (_ecm.HasNewEntities() || removing || this->entitiesRemoved)
+    this->InvalidateEntityCache();
+  this->entitiesRemoved = removing;
+
+  // Compute the contents of all the regions at once.
+  this->regionIndex.Update(_ecm);
+
   bool complete = true;
+  bool failed = false;
+  const bool failFastEnabled = this->failFast.value_or(false);
   for (std::unique_ptr<Trigger> &trigger : this->triggers)
   {
     trigger->Update(_info, this, _ecm);
     complete = complete && trigger->Result();
+    failed = failed || (failFastEnabled && trigger->HasFailed());
+  }
+
+  // Report progress at most once per period, so that progress never
+  // slows down the simulation.
+  if (this->progressCb)
+  {
+    std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+    if (now - this->lastProgressTime >= this->progressPeriod)
+      this->ReportProgress(_info, now);
   }
 
   // If the test is complete, then stop.
@@ -136,6 +172,59 @@ void Test::PostUpdate(const sim::UpdateInfo &_info,
   {
     this->stopCb();
   }
+  // A failed trigger fails the test, whatever the other triggers do.
+  else if (failed && !this->failedFast)
+  {
+    gzmsg << "Test[" << this->Name() << "] failed at sim time "
+      << std::chrono::duration<double>(_info.simTime).count()
+      << "s, stopping\n";
+    this->failedFast = true;
+    this->stopCb();
+  }
+}
+
+//////////////////////////////////////////////////
+void Test::ReportProgress(const sim::UpdateInfo &_info,
+    const std::chrono::steady_clock::time_point &_now)
+{
+  domain::Progress msg;
+  msg.set_test_name(this->Name());
+
+  std::pair<int64_t, int64_t> simTime =
+    math::durationToSecNsec(_info.simTime);
+  msg.mutable_sim_time()->set_seconds(simTime.first);
+  msg.mutable_sim_time()->set_nanos(simTime.second);
+
+  // The real time factor is measured since the previous report.
+  if (this->lastProgressTime != std::chrono::steady_clock::time_point())
+  {
+    std::chrono::duration<double> realDt = _now - this->lastProgressTime;
+    std::chrono::duration<double> simDt =
+      _info.simTime - this->lastProgressSimTime;
+    if (realDt.count() > 0)
+      msg.set_real_time_factor(simDt.count() / realDt.count());
+  }
+  this->lastProgressTime = _now;
+  this->lastProgressSimTime = _info.simTime;
+
+  int fired = 0;
+  int pending = 0;
+  int passed = 0;
+  int failed = 0;
+  for (const std::unique_ptr<Trigger> &trigger : this->triggers)
+  {
+    fired += trigger->Triggered() ? 1 : 0;
+    pending += trigger->Result() ? 0 : 1;
+    passed += trigger->ExpectationPassCount();
+    failed += trigger->ExpectationFailCount();
+  }
+  msg.set_trigger_count(static_cast<int>(this->triggers.size()));
+  msg.set_triggers_fired(fired);
+  msg.set_triggers_pending(pending);
+  msg.set_expectations_passed(passed);
+  msg.set_expectations_failed(failed);
+
+  this->progressCb(msg);
 }
 
 //////////////////////////////////////////////////
@@ -155,10 +244,31 @@ bool Test::FillResults(domain::Test *_msg) const
     // Set failed if there is no result or the result is false.
     triggerMsg->set_failed(triggerFailed);
 
+    ProcessManager::Stats stats = trigger->CommandStats();
+    triggerMsg->set_exit_code(stats.lastExitCode);
+    triggerMsg->set_command_count(stats.exitCount);
+    triggerMsg->set_command_fail_count(stats.failCount);
+    std::pair<int64_t, int64_t> cpuTime =
+      math::durationToSecNsec(stats.cpuTime);
+    triggerMsg->mutable_cpu_time()->set_seconds(cpuTime.first);
+    triggerMsg->mutable_cpu_time()->set_nanos(cpuTime.second);
+    triggerMsg->set_max_rss(stats.maxRss);
+
     failed = failed || triggerFailed;
+
+    for (const std::string &log : trigger->LogFiles())
+    {
+      domain::Artifact *artifact = _msg->add_artifacts();
+      artifact->set_kind(log.find(".stderr.log") != std::string::npos ?
+          "stderr" : "stdout");
+      // File URLs need an absolute path, and the output path may be
+      // relative.
+      artifact->set_url("file://" + common::absPath(log));
+    }
   }
 
   _msg->set_failed(failed);
+  _msg->set_failed_fast(this->failedFast);
   return !failed;
 }
 
@@ -173,17 +283,104 @@ bool Test::HasTrigger(const std::string &_name) const
   return false;
 }
 
+//////////////////////////////////////////////////
+Trigger *Test::TriggerByName(const std::string &_name) const
+{
+  for (const std::unique_ptr<Trigger> &trigger : this->triggers)
+  {
+    if (trigger->Name() == _name)
+      return trigger.get();
+  }
+  return nullptr;
+}
+
+//////////////////////////////////////////////////
+sim::Entity Test::EntityByName(const std::string &_name,
+    const sim::EntityComponentManager &_ecm)
+{
+  auto iter = this->entityCache.find(_name);
+  if (iter != this->entityCache.end())
+    return iter->second;
+
+  // Models are preferred over other entities with the same name, such as
+  // a link named after its model. Any remaining tie is broken by the
+  // lowest entity id, so that the result doesn't depend on hashing.
+  sim::Entity entity = sim::kNullEntity;
+  bool entityIsModel = false;
+  size_t candidates = 0;
+  for (const sim::Entity &match : sim::entitiesFromScopedName(_name, _ecm))
+  {
+    bool isModel = _ecm.Component<sim::components::Model>(match) != nullptr;
+    if (entity == sim::kNullEntity || (isModel && !entityIsModel))
+    {
+      entity = match;
+      entityIsModel = isModel;
+      candidates = 1;
+    }
+    else if (isModel == entityIsModel)
+    {
+      entity = std::min(entity, match);
+      candidates++;
+    }
+  }
+
+  if (candidates > 1)
+  {
+    gzerr << "Name[" << _name << "] is ambiguous, " << candidates
+      << (entityIsModel ? " models" : " entities") << " have it. Using "
+      << "entity[" << entity << "]\n";
+  }
+
+  this->entityCache[_name] = entity;
+  return entity;
+}
+
+//////////////////////////////////////////////////
+sim::Entity Test::ModelByName(const std::string &_name,
+    const sim::EntityComponentManager &_ecm)
+{
+  // EntityByName prefers models, so any model with the name is found.
+  sim::Entity entity = this->EntityByName(_name, _ecm);
+  if (entity == sim::kNullEntity ||
+      !_ecm.Component<sim::components::Model>(entity))
+  {
+    return sim::kNullEntity;
+  }
+  return entity;
+}
+
+//////////////////////////////////////////////////
+uint64_t Test::EntityGeneration() const
+{
+  return this->entityGeneration;
+}
+
+//////////////////////////////////////////////////
+void Test::InvalidateEntityCache()
+{
+  this->entityCache.clear();
+  this->entityGeneration++;
+}
+
+//////////////////////////////////////////////////
+const RegionIndex &Test::Regions() const
+{
+  return this->regionIndex;
+}
+
 //////////////////////////////////////////////////
 std::optional<bool> Test::RunTriggerFunction(
                   const std::string &_triggerName,
                   const std::string &_functionName,
-                  const std::string &_parameter)
+                  const std::string &_parameter,
+                  const sim::EntityComponentManager &_ecm)
 {
   for (std::unique_ptr<Trigger> &trigger : this->triggers)
   {
     if (trigger->Name() == _triggerName)
     {
-      return trigger->RunFunction(_functionName, _parameter);
+      return trigger->RunFunction(_functionName, _parameter,
+          this->ModelByName(_parameter, _ecm));
     }
   }
   return std::nullopt;
@@ -216,9 +413,55 @@ void Test::SetStopCallback(std::function<void()> &_cb)
   this->stopCb = _cb;
 }
 
+//////////////////////////////////////////////////
+void Test::SetFailFast(bool _failFast)
+{
+  this->failFast = _failFast;
+}
+
+//////////////////////////////////////////////////
+std::optional<bool> Test::FailFast() const
+{
+  return this->failFast;
+}
+
+//////////////////////////////////////////////////
+void Test::SetEnvironment(const std::list<std::string> &_envs)
+{
+  this->envs = _envs;
+}
+
+//////////////////////////////////////////////////
+const std::list<std::string> &Test::Environment() const
+{
+  return this->envs;
+}
+
+//////////////////////////////////////////////////
+void Test::SetLogPath(const std::string &_path)
+{
+  for (std::unique_ptr<Trigger> &trigger : this->triggers)
+    trigger->SetLogPath(_path);
+}
+
+//////////////////////////////////////////////////
+void Test::SetProgressCallback(
+    const std::function<void(domain::Progress &)> &_cb,
+    const std::chrono::steady_clock::duration &_period)
+{
+  this->progressCb = _cb;
+  this->progressPeriod = _period;
+}
+
 //////////////////////////////////////////////////
 void Test::Reset()
 {
+  this->InvalidateEntityCache();
+  this->entitiesRemoved = false;
+  this->failedFast = false;
+  this->lastProgressTime = std::chrono::steady_clock::time_point();
+  this->lastProgressSimTime = std::chrono::steady_clock::duration::zero();
+  this->regionIndex.Reset();
   for (std::unique_ptr<Trigger> &trigger : this->triggers)
   {
     trigger->Reset();
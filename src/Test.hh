@@ -18,12 +18,17 @@
 #define GZ_TEST_TEST_HH_
 
 #include <yaml-cpp/yaml.h>
+#include <list>
+#include <string>
+#include <unordered_map>
 
 #include <gz/sim/Server.hh>
 #include <gz/sim/ServerConfig.hh>
 #include <gz/sim/World.hh>
 
+#include "msgs/progress.pb.h"
 #include "msgs/test.pb.h"
+#include "RegionIndex.hh"
 #include "Trigger.hh"
 #include "Util.hh"
 #include "gz/test/config.hh"
@@ -83,10 +88,49 @@ namespace gz
       /// \return True if the trigger exists.
       public: bool HasTrigger(const std::string &_name) const;
 
+      /// \brief Get a trigger by name.
+      /// \param[in] _name Name of the trigger.
+      /// \return Pointer to the trigger, or nullptr if the trigger does
+      /// not exist.
+      public: Trigger *TriggerByName(const std::string &_name) const;
+
+      /// \brief Resolve a scoped entity name, such as a model name used in
+      /// an expression. When several entities have the name, models are
+      /// preferred, then the lowest entity id, and an error is logged.
+      /// Results, including names that could not be resolved, are cached
+      /// until an entity is created or removed.
+      /// \param[in] _name Scoped name of the entity.
+      /// \param[in] _ecm The entity component manager.
+      /// \return The entity, or kNullEntity if no entity has the name.
+      public: sim::Entity EntityByName(const std::string &_name,
+                  const sim::EntityComponentManager &_ecm);
+
+      /// \brief Resolve a scoped model name, such as the parameter of a
+      /// trigger function. Other entities with the name are ignored.
+      /// \param[in] _name Scoped name of the model.
+      /// \param[in] _ecm The entity component manager.
+      /// \return The model entity, or kNullEntity if no model has the
+      /// name.
+      public: sim::Entity ModelByName(const std::string &_name,
+                  const sim::EntityComponentManager &_ecm);
+
+      /// \brief Get the generation of the entity cache. The generation
+      /// changes every time the cache is invalidated, which lets callers
+      /// hold on to an entity returned by EntityByName or ModelByName
+      /// until the generation changes.
+      /// \return The entity cache generation.
+      public: uint64_t EntityGeneration() const;
+
+      /// \brief Get the spatial index of the test's regions, updated once
+      /// per post update before the triggers.
+      /// \return The region index.
+      public: const RegionIndex &Regions() const;
+
       public: std::optional<bool> RunTriggerFunction(
                   const std::string &_triggerName,
                   const std::string &_functionName,
-                  const std::string &_parameter);
+                  const std::string &_parameter,
+                  const sim::EntityComponentManager &_ecm);
 
       /// \brief Stop the test.
       public: void Stop();
@@ -100,6 +144,42 @@ namespace gz
 
       public: void SetStopCallback(std::function<void()> &_cb);
 
+      /// \brief Set whether the test stops as soon as one of its triggers
+      /// fails, rather than when all triggers have a result or the time
+      /// limit is reached.
+      /// \param[in] _failFast True to stop as soon as the test fails.
+      public: void SetFailFast(bool _failFast);
+
+      /// \brief Get the fail-fast setting of the test.
+      /// \return The setting, or std::nullopt if the test doesn't have
+      /// one.
+      public: std::optional<bool> FailFast() const;
+
+      /// \brief Set environment variables for the commands run by the
+      /// test's triggers.
+      /// \param[in] _envs Environment variables, in "NAME=value" form.
+      public: void SetEnvironment(const std::list<std::string> &_envs);
+
+      /// \brief Get the environment variables for the commands run by the
+      /// test's triggers.
+      /// \return Environment variables, in "NAME=value" form.
+      public: const std::list<std::string> &Environment() const;
+
+      /// \brief Log the output of the commands run by the test's triggers
+      /// to a directory. The log files are listed as artifacts in the
+      /// results.
+      /// \param[in] _path The directory.
+      public: void SetLogPath(const std::string &_path);
+
+      /// \brief Set a function that receives the progress of the test.
+      /// The function is called from PostUpdate at most once per period
+      /// of real time, so it must return quickly.
+      /// \param[in] _cb The function, or nullptr to disable progress.
+      /// \param[in] _period Minimum real time between two calls.
+      public: void SetProgressCallback(
+                  const std::function<void(domain::Progress &)> &_cb,
+                  const std::chrono::steady_clock::duration &_period);
+
       /// \brief Reset the test. This clears the results.
       public: void Reset();
 
@@ -111,10 +191,54 @@ namespace gz
       /// \brief The list of triggers for the test.
       private: std::vector<std::unique_ptr<Trigger>> triggers;
 
+      /// \brief Clear the entity cache, and bump its generation.
+      private: void InvalidateEntityCache();
+
+      /// \brief Cache of scoped names to entities.
+      private: std::unordered_map<std::string, sim::Entity> entityCache;
+
+      /// \brief Generation of the entity cache.
+      private: uint64_t entityGeneration{0};
+
+      /// \brief True if entities were marked for removal in the previous
+      /// update. They are removed before the next update.
+      private: bool entitiesRemoved{false};
+
+      /// \brief Regions of the region triggers.
+      private: RegionIndex regionIndex;
+
       public: std::chrono::steady_clock::duration maxDuration{0s};
       public: TimeType maxDurationType{TimeType::SIM};
 
       public: std::function<void()> stopCb;
+
+      /// \brief Whether the test stops as soon as it fails.
+      private: std::optional<bool> failFast;
+
+      /// \brief True if the test was stopped because it failed.
+      private: bool failedFast{false};
+
+      /// \brief Environment variables for trigger commands.
+      private: std::list<std::string> envs;
+
+      /// \brief Report the progress of the test to the progress callback.
+      /// \param[in] _info The current update info.
+      /// \param[in] _now The current real time.
+      private: void ReportProgress(const sim::UpdateInfo &_info,
+                   const std::chrono::steady_clock::time_point &_now);
+
+      /// \brief Function that receives the progress of the test.
+      private: std::function<void(domain::Progress &)> progressCb;
+
+      /// \brief Minimum real time between two progress reports.
+      private: std::chrono::steady_clock::duration progressPeriod{1s};
+
+      /// \brief Real time of the last progress report, used to throttle
+      /// the reports and compute the real time factor.
+      private: std::chrono::steady_clock::time_point lastProgressTime;
+
+      /// \brief Simulation time of the last progress report.
+      private: std::chrono::steady_clock::duration lastProgressSimTime{0};
     };
     }
   }
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+
+#include "TestTemplate.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+TestTemplate::TestTemplate(const YAML::Node &_node)
+{
+  this->root = this->Compile(_node);
+}
+
+/////////////////////////////////////////////////
+const std::vector<std::string> &TestTemplate::Names() const
+{
+  return this->names;
+}
+
+/////////////////////////////////////////////////
+YAML::Node TestTemplate::Bind(
+    const std::vector<const std::string *> &_values) const
+{
+  return Build(this->root, _values);
+}
+
+/////////////////////////////////////////////////
+TestTemplate::Node TestTemplate::Compile(const YAML::Node &_node)
+{
+  Node node;
+  node.type = _node.Type();
+  node.tag = _node.Tag();
+
+  switch (node.type)
+  {
+    case YAML::NodeType::Scalar:
+      node.parts = this->Split(_node.Scalar());
+      break;
+    case YAML::NodeType::Sequence:
+      for (YAML::const_iterator it = _node.begin(); it != _node.end(); ++it)
+        node.children.push_back(this->Compile(*it));
+      break;
+    case YAML::NodeType::Map:
+      for (YAML::const_iterator it = _node.begin(); it != _node.end(); ++it)
+      {
+        node.children.push_back(this->Compile(it->first));
+        node.children.push_back(this->Compile(it->second));
+      }
+      break;
+    default:
+      break;
+  }
+  return node;
+}
+
+/////////////////////////////////////////////////
+std::vector<TestTemplate::Part> TestTemplate::Split(
+    const std::string &_scalar)
+{
+  std::vector<Part> parts;
+  auto addLiteral = [&parts](const std::string &_text)
+  {
+    if (_text.empty())
+      return;
+    if (!parts.empty() && parts.back().name < 0)
+      parts.back().text += _text;
+    else
+      parts.push_back({_text, -1});
+  };
+
+  // Each "}}" closes the nearest "${{" before it, so that a placeholder
+  // nested in an expression is still found.
+  size_t pos = 0;
+  for (size_t close = _scalar.find("}}"); close != std::string::npos;
+       close = _scalar.find("}}", pos))
+  {
+    size_t open = _scalar.rfind("${{", close);
+    if (open == std::string::npos || open < pos)
+    {
+      addLiteral(_scalar.substr(pos, close + 2 - pos));
+      pos = close + 2;
+      continue;
+    }
+
+    addLiteral(_scalar.substr(pos, open - pos));
+
+    std::string name = _scalar.substr(open + 3, close - open - 3);
+    auto iter = std::find(this->names.begin(), this->names.end(), name);
+    if (iter == this->names.end())
+      iter = this->names.insert(this->names.end(), name);
+    parts.push_back({_scalar.substr(open, close + 2 - open),
+        static_cast<int>(iter - this->names.begin())});
+    pos = close + 2;
+  }
+  addLiteral(_scalar.substr(pos));
+
+  // An empty scalar still needs one part.
+  if (parts.empty())
+    parts.push_back({"", -1});
+  return parts;
+}
+
+/////////////////////////////////////////////////
+YAML::Node TestTemplate::Build(const Node &_node,
+    const std::vector<const std::string *> &_values)
+{
+  YAML::Node result(_node.type);
+  switch (_node.type)
+  {
+    case YAML::NodeType::Scalar:
+    {
+      std::string scalar;
+      for (const Part &part : _node.parts)
+      {
+        if (part.name >= 0 && _values.at(part.name))
+          scalar += *_values.at(part.name);
+        else
+          scalar += part.text;
+      }
+      result = scalar;
+      break;
+    }
+    case YAML::NodeType::Sequence:
+      for (const Node &child : _node.children)
+        result.push_back(Build(child, _values));
+      break;
+    case YAML::NodeType::Map:
+      for (size_t i = 0; i + 1 < _node.children.size(); i += 2)
+      {
+        result[Build(_node.children[i], _values)] =
+          Build(_node.children[i + 1], _values);
+      }
+      break;
+    default:
+      break;
+  }
+  if (!_node.tag.empty())
+    result.SetTag(_node.tag);
+  return result;
+}
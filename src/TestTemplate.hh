@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef GZ_TEST_TESTTEMPLATE_HH_
+#define GZ_TEST_TESTTEMPLATE_HH_
+
+#include <yaml-cpp/yaml.h>
+
+#include <string>
+#include <vector>
+
+#include "gz/test/config.hh"
+
+namespace gz
+{
+  namespace test
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace GZ_TEST_VERSION_NAMESPACE {
+    /// \brief A test description with parameter placeholders, such as
+    /// "${{velocity}}", located once. Binding the values of an iteration
+    /// fills the placeholders and builds the YAML nodes of the test,
+    /// without parsing any text.
+    ///
+    /// Placeholders whose name has no value are left as is, which keeps
+    /// expressions such as "${{simulation.time > 10.0}}" intact.
+    class TestTemplate
+    {
+      /// \brief Build the template of a test.
+      /// \param[in] _node The YAML node of the test.
+      public: explicit TestTemplate(const YAML::Node &_node);
+
+      /// \brief Get the names of the placeholders, in the order expected
+      /// by Bind.
+      /// \return The distinct placeholder names.
+      public: const std::vector<std::string> &Names() const;
+
+      /// \brief Build the YAML node of the test with the given values.
+      /// \param[in] _values The value of each placeholder name, in the
+      /// order of Names, or nullptr to leave the placeholder as is.
+      /// \return A new YAML node.
+      public: YAML::Node Bind(
+                  const std::vector<const std::string *> &_values) const;
+
+      /// \brief A piece of a scalar, either literal text or a placeholder.
+      private: class Part
+               {
+                 /// \brief The literal text, or the original text of the
+                 /// placeholder.
+                 public: std::string text;
+
+                 /// \brief Index of the placeholder name in names, or -1
+                 /// for literal text.
+                 public: int name{-1};
+               };
+
+      /// \brief A YAML node with its scalars split into parts.
+      private: class Node
+               {
+                 /// \brief Type of the node.
+                 public: YAML::NodeType::value type{YAML::NodeType::Null};
+
+                 /// \brief Tag of the node.
+                 public: std::string tag;
+
+                 /// \brief Parts of a scalar node.
+                 public: std::vector<Part> parts;
+
+                 /// \brief Items of a sequence, or alternating keys and
+                 /// values of a map.
+                 public: std::vector<Node> children;
+               };
+
+      /// \brief Build the template of a YAML node.
+      /// \param[in] _node The YAML node.
+      /// \return The template node.
+      private: Node Compile(const YAML::Node &_node);
+
+      /// \brief Split a scalar into literal text and placeholders.
+      /// \param[in] _scalar The scalar.
+      /// \return The parts of the scalar.
+      private: std::vector<Part> Split(const std::string &_scalar);
+
+      /// \brief Build the YAML node of a template node.
+      /// \param[in] _node The template node.
+      /// \param[in] _values The values of the placeholder names.
+      /// \return A new YAML node.
+      private: static YAML::Node Build(const Node &_node,
+                   const std::vector<const std::string *> &_values);
+
+      /// \brief The template of the test.
+      private: Node root;
+
+      /// \brief Distinct placeholder names.
+      private: std::vector<std::string> names;
+    };
+    }
+  }
+}
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include <string>
+#include <vector>
+
+#include "TestTemplate.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+TEST(TestTemplate, Names)
+{
+  TestTemplate testTemplate(YAML::Load(
+        "{name: 'drive ${{velocity}}', speed: '${{velocity}}',"
+        " steps: ['${{count}}', 'none'], '${{key}}': 1}"));
+
+  // Names are distinct, in the order they are first found.
+  EXPECT_EQ((std::vector<std::string>{"velocity", "count", "key"}),
+      testTemplate.Names());
+}
+
+/////////////////////////////////////////////////
+TEST(TestTemplate, Bind)
+{
+  TestTemplate testTemplate(YAML::Load(
+        "{name: 'drive ${{velocity}} m/s', speed: '${{velocity}}',"
+        " steps: ['${{count}}', 'none'], '${{key}}': 1}"));
+  ASSERT_EQ(3u, testTemplate.Names().size());
+
+  std::string velocity = "0.5";
+  std::string count = "3";
+  std::string key = "weight";
+  YAML::Node node = testTemplate.Bind({&velocity, &count, &key});
+  EXPECT_EQ("drive 0.5 m/s", node["name"].as<std::string>());
+  EXPECT_DOUBLE_EQ(0.5, node["speed"].as<double>());
+  ASSERT_TRUE(node["steps"].IsSequence());
+  EXPECT_EQ(3, node["steps"][0].as<int>());
+  EXPECT_EQ("none", node["steps"][1].as<std::string>());
+  EXPECT_EQ(1, node["weight"].as<int>());
+
+  // The template can be bound again with other values.
+  velocity = "2";
+  node = testTemplate.Bind({&velocity, &count, &key});
+  EXPECT_EQ("drive 2 m/s", node["name"].as<std::string>());
+}
+
+/////////////////////////////////////////////////
+TEST(TestTemplate, UnboundPlaceholdersAreKept)
+{
+  TestTemplate testTemplate(YAML::Load(
+        "{expect: '${{simulation.time > 10.0}}', speed: '${{velocity}}'}"));
+  ASSERT_EQ(2u, testTemplate.Names().size());
+
+  std::string velocity = "1.5";
+  std::vector<const std::string *> values(2, nullptr);
+  values[1] = &velocity;
+  YAML::Node node = testTemplate.Bind(values);
+  EXPECT_EQ("${{simulation.time > 10.0}}", node["expect"].as<std::string>());
+  EXPECT_EQ("1.5", node["speed"].as<std::string>());
+}
+
+/////////////////////////////////////////////////
+TEST(TestTemplate, NestedPlaceholders)
+{
+  TestTemplate testTemplate(YAML::Load(
+        "{expect: '${{simulation.time > ${{region-time}}}} and"
+        " ${{a}}${{b}}'}"));
+
+  // Each "}}" closes the nearest "${{", so the placeholder nested in the
+  // expression is found, and the expression itself is literal text.
+  EXPECT_EQ((std::vector<std::string>{"region-time", "a", "b"}),
+      testTemplate.Names());
+
+  std::string time = "10.0";
+  std::string a = "x";
+  std::string b = "y";
+  YAML::Node node = testTemplate.Bind({&time, &a, &b});
+  EXPECT_EQ("${{simulation.time > 10.0}} and xy",
+      node["expect"].as<std::string>());
+
+  // Without values, the text is unchanged.
+  node = testTemplate.Bind({nullptr, nullptr, nullptr});
+  EXPECT_EQ("${{simulation.time > ${{region-time}}}} and ${{a}}${{b}}",
+      node["expect"].as<std::string>());
+}
+
+/////////////////////////////////////////////////
+TEST(TestTemplate, UnmatchedBraces)
+{
+  TestTemplate testTemplate(YAML::Load(
+        "{a: 'x }} y', b: '${{ open', c: '}}${{v}}', d: ''}"));
+  EXPECT_EQ((std::vector<std::string>{"v"}), testTemplate.Names());
+
+  std::string v = "1";
+  YAML::Node node = testTemplate.Bind({&v});
+  EXPECT_EQ("x }} y", node["a"].as<std::string>());
+  EXPECT_EQ("${{ open", node["b"].as<std::string>());
+  EXPECT_EQ("}}1", node["c"].as<std::string>());
+  EXPECT_EQ("", node["d"].as<std::string>());
+}
+
+/////////////////////////////////////////////////
+TEST(TestTemplate, TagsAreKept)
+{
+  TestTemplate testTemplate(YAML::Load("{pose: !pose '${{x}} 0 0'}"));
+  std::string x = "4";
+  YAML::Node node = testTemplate.Bind({&x});
+  EXPECT_EQ("!pose", node["pose"].Tag());
+  EXPECT_EQ("4 0 0", node["pose"].as<std::string>());
+}
@@ -14,7 +14,6 @@
  * limitations under the License.
  *
 */
-#include <regex>
 #ifndef _WIN32
   #include <semaphore.h>
   #include <sys/stat.h>
@@ -75,15 +74,21 @@ bool Trigger::LoadOnCommands(const YAML::Node &_node)
       }
 
     }
-    else if ((*it)["expect"])
+    else if ((*it)["expect"] || (*it)["assert"])
     {
-      std::string expectation = (*it)["expect"].as<std::string>();
-      this->expectations.push_back({expectation, false});
-    }
-    else if ((*it)["assert"])
-    {
-      std::string assertion = (*it)["assert"].as<std::string>();
-      this->expectations.push_back({assertion, true});
+      bool assertion = static_cast<bool>((*it)["assert"]);
+      std::string str = assertion ? (*it)["assert"].as<std::string>() :
+        (*it)["expect"].as<std::string>();
+
+      // Compile the expression once, so that checking it doesn't require
+      // any string processing.
+      std::unique_ptr<Expression> expression = Expression::Compile(str);
+      if (!expression)
+      {
+        gzerr << "Invalid expectation[" << str << "]\n";
+        continue;
+      }
+      this->expectations.push_back({std::move(expression), assertion});
     }
 
   }
@@ -95,50 +100,35 @@ bool Trigger::CheckExpectations(const sim::UpdateInfo &_info, Test *_test,
     const sim::EntityComponentManager &_ecm)
 {
   bool expResult = true;
-  for (const std::pair<std::string, bool> &expect : this->expectations)
+  for (const std::pair<std::unique_ptr<Expression>, bool> &expect :
+       this->expectations)
   {
-    // Strip out the beginning "${{" and ending "}}"
-    size_t startIdx = expect.first.find("${{")+3;
-    size_t endIdx = expect.first.find("}}");
-    std::string exp = expect.first.substr(startIdx, endIdx-startIdx);
-
-    // Attempt to get a result from an expectation that is an equation.
-    std::optional<bool> r = this->ParseEquation(_info, exp, _ecm);
-    if (r)
+    // An expectation without a value, such as one on the exit code of a
+    // command that hasn't exited, fails rather than being skipped.
+    std::optional<bool> r = expect.first->Evaluate(_info, _test, _ecm);
+    if (!r)
     {
-      expResult = expResult && *r;
-
-      // Short circuit if assert and result was false
-      if (expect.second && !(*r))
-      {
-        gzerr << "Assertion\n";
-        return expResult;
-      }
-
-      if (!(*r))
-        gzdbg << "Expecation[" << exp << "] failed\n";
-      continue;
+      gzerr << "Unable to evaluate expectation[" << expect.first->Text()
+        << "], counting it as failed\n";
+      r = false;
     }
 
-    // Attempt to get a result from an expectation that is a function.
-    r = this->ParseFunction(_test, exp);
-    if (r)
-    {
-      expResult = expResult && *r;
-
-      // Short circuit if assert and results was false
-      if (expect.second && !(*r))
-      {
-        gzerr << "Assertion\n";
-        return expResult;
-      }
-
-      if (!(*r))
-        gzdbg << "Expecation[" << exp << "] failed\n";
+    expResult = expResult && *r;
+    if (*r)
+      this->expectationPassCount++;
+    else
+      this->expectationFailCount++;
 
-      continue;
+    // Short circuit if assert and result was false
+    if (expect.second && !(*r))
+    {
+      gzerr << "Assertion[" << expect.first->Text() << "] failed\n";
+      this->assertionFailed = true;
+      return expResult;
     }
-    gzerr << "Invalid expectation[" << exp << "]\n";
+
+    if (!(*r))
+      gzdbg << "Expecation[" << expect.first->Text() << "] failed\n";
   }
   return expResult;
 }
@@ -150,7 +140,18 @@ bool Trigger::RunOnCommands(const sim::UpdateInfo &_info, Test *_test,
   if (!this->CheckExpectations(_info, _test, _ecm))
     return false;
 
-  return this->processManager.RunExecutablesAsBash(this->commands);
+  if (this->commands.empty())
+    return true;
+
+  // Launch the commands off the simulation thread. A failed launch fails
+  // the trigger once it is reported.
+  this->processManager.RunExecutablesAsBashAsync(this->commands,
+      _test->Environment(), [this](bool _success)
+      {
+        if (!_success)
+          this->launchFailed = true;
+      });
+  return true;
 }
 
 //////////////////////////////////////////////////
@@ -189,194 +190,73 @@ void Trigger::SetResult(bool _passed)
 //////////////////////////////////////////////////
 std::optional<bool> Trigger::Result() const
 {
+  if (this->launchFailed || this->processManager.ExitStats().failCount > 0)
+    return false;
   return this->result;
 }
 
 //////////////////////////////////////////////////
-std::optional<bool> Trigger::ParseFunction(Test *_test,
-    const std::string &_str)
+void Trigger::RegisterFunction(const std::string &_name,
+    TriggerFunction &_func)
 {
-  std::string str = common::trimmed(_str);
-  std::vector<std::string> parts = common::split(str, ".");
-  if (parts.size() > 1)
-  {
-    std::string part1 = common::trimmed(parts[0]);
-
-    // Check if there is a negation
-    bool negate = false;
-    if (part1[0] == '!')
-    {
-      negate = true;
-      part1.erase(0,1);
-    }
-
-    // Make sure the named trigger exists.
-    if (_test->HasTrigger(part1))
-    {
-      std::string function = common::trimmed(parts[1]);
-      size_t parenStart = function.find("(");
-      size_t parenEnd = function.find(")");
-      std::string functionName = function.substr(0, parenStart);
-      std::string param = function.substr(parenStart+1,
-          parenEnd-parenStart-1);
-
-      // Get the result of running the trigger's function.
-      std::optional<bool> funcResult =
-        _test->RunTriggerFunction(part1, functionName, param);
-
-      // Negate the results if necessary.
-      if (funcResult && negate)
-        return !(*funcResult);
-
-      return funcResult;
-    }
-  }
-
-  return std::nullopt;
+  this->functions[_name] = _func;
 }
 
 //////////////////////////////////////////////////
-std::optional<bool> Trigger::ParseEquation(const sim::UpdateInfo &_info,
-    const std::string &_str,
-    const sim::EntityComponentManager &_ecm)
+std::optional<bool> Trigger::RunFunction(const std::string &_name,
+    const std::string &_param, const sim::Entity &_entity)
 {
-  std::regex reg(R"(==|!=|>=|<=|<|>)");
-  auto expBegin = std::sregex_iterator(_str.begin(), _str.end(), reg);
-  auto expEnd = std::sregex_iterator();
-  for (std::sregex_iterator it = expBegin; it != expEnd; ++it)
-  {
-    std::smatch match = *it;
-
-    std::string prefix = it->prefix().str();
-    std::string suffix = it->suffix().str();
-
-    std::optional<double> preValue = this->ParseValue(prefix, _info, _ecm);
-    std::optional<double> sufValue = this->ParseValue(suffix, _info, _ecm);
-
-    if (preValue && sufValue)
-    {
-      if (it->str() == "==")
-        return math::equal(*preValue, *sufValue);
-      else if (it->str() == "!=")
-        return !math::equal(*preValue, *sufValue);
-      else if (it->str() == ">=")
-        return *preValue >= *sufValue;
-      else if (it->str() == "<=")
-        return *preValue <= *sufValue;
-      else if (it->str() == ">")
-        return *preValue > *sufValue;
-      else if (it->str() == "<")
-      {
-        std::cout << "Pre[" << *preValue << "] Suf[" << *sufValue << "]\n";
-        return *preValue < *sufValue;
-      }
-      else
-        gzerr << "Invalid equation operation[" << it->str() << "]\n";
-    }
-    else
-      gzerr << "Unable to parse equation prefix or suffix\n";
-  }
+  if (this->functions.find(_name) != this->functions.end())
+    return this->functions[_name](_param, _entity);
+  gzerr << "Trigger[" << this->Name() << "] does not have function["
+    << _name << "]\n";
   return std::nullopt;
 }
 
 //////////////////////////////////////////////////
-std::optional<double> Trigger::ParseValue(const std::string &_str,
-    const sim::UpdateInfo &_info,
-    const sim::EntityComponentManager &_ecm)
+const TriggerFunction *Trigger::Function(
+    const std::string &_name) const
 {
-  std::string str = common::trimmed(_str);
-
-  // Try to parse the string as a double.
-  try
-  {
-    return std::stod(str);
-  }
-  catch(...)
-  {
-    // Do nothing here.
-  }
-
-  // Does the string contain dots?
-  if (str.find(".") != std::string::npos)
-  {
-    std::vector<std::string> parts = common::split(str, ".");
-
-    // Try to get Gazebo entities based on the name
-    std::unordered_set<sim::Entity> entities =
-      sim::entitiesFromScopedName(parts[0], _ecm);
-
-    if (!entities.empty())
-    {
-      if (parts.size() == 3 && parts[1] == "pose")
-      {
-        // Get the pose of the entity
-        math::Pose3d pose = sim::worldPose(*entities.begin(), _ecm);
-        return ParsePoseProperty(pose, parts[2]);
-      }
-      else
-      {
-        gzerr << "Invalid expectation parameter[" << str << "]\n";
-      }
-    }
-    else if (parts[0] == "simulation")
-    {
-      if (parts.size() == 2 && parts[1] == "time")
-        return std::chrono::duration<double>(_info.simTime).count();
-    }
-  }
-  else if (math::isTimeString(str))
-  {
-    return static_cast<double>(math::stringToDuration(str).count());
-  }
+  auto iter = this->functions.find(_name);
+  if (iter != this->functions.end())
+    return &iter->second;
+  return nullptr;
+}
 
-  return std::nullopt;
+//////////////////////////////////////////////////
+void Trigger::Stop()
+{
+  this->processManager.Stop();
 }
 
 //////////////////////////////////////////////////
-std::optional<double> Trigger::ParsePoseProperty(const math::Pose3d &_pose,
-    const std::string &_propertyStr)
+void Trigger::SetLogPath(const std::string &_path)
 {
-  std::string prop = common::trimmed(_propertyStr);
-  if (prop == "x")
-    return _pose.Pos().X();
-  else if (prop == "y")
-    return _pose.Pos().Y();
-  else if (prop == "z")
-    return _pose.Pos().Z();
-  else if (prop == "roll")
-    return _pose.Rot().Euler().X();
-  else if (prop == "pitch")
-    return _pose.Rot().Euler().Y();
-  else if (prop == "yaw")
-    return _pose.Rot().Euler().Z();
-  else
-    gzerr << "Unable to get pose value for string[" << prop << "]\n";
+  this->processManager.SetLogDirectory(_path, this->Name());
+}
 
-  return std::nullopt;
+//////////////////////////////////////////////////
+ProcessManager::Stats Trigger::CommandStats() const
+{
+  return this->processManager.ExitStats();
 }
 
 //////////////////////////////////////////////////
-void Trigger::RegisterFunction(const std::string &_name,
-    std::function<bool(const std::string &)> &_func)
+std::vector<std::string> Trigger::LogFiles() const
 {
-  this->functions[_name] = _func;
+  return this->processManager.LogFiles();
 }
 
 //////////////////////////////////////////////////
-std::optional<bool> Trigger::RunFunction(const std::string &_name,
-    const std::string &_param)
+unsigned int Trigger::ExpectationPassCount() const
 {
-  if (this->functions.find(_name) != this->functions.end())
-    return this->functions[_name](_param);
-  gzerr << "Trigger[" << this->Name() << "] does not have function["
-    << _name << "]\n";
-  return std::nullopt;
+  return this->expectationPassCount;
 }
 
 //////////////////////////////////////////////////
-void Trigger::Stop()
+unsigned int Trigger::ExpectationFailCount() const
 {
-  this->processManager.Stop();
+  return this->expectationFailCount;
 }
 
 //////////////////////////////////////////////////
@@ -384,6 +264,10 @@ void Trigger::Reset()
 {
   this->result = std::nullopt;
   this->triggered = false;
+  this->launchFailed = false;
+  this->assertionFailed = false;
+  this->expectationPassCount = 0;
+  this->expectationFailCount = 0;
   this->ResetImpl();
 }
 
@@ -398,3 +282,23 @@ bool Trigger::Triggered() const
 {
   return this->triggered;
 }
+
+//////////////////////////////////////////////////
+bool Trigger::HasFailed() const
+{
+  if (this->assertionFailed)
+    return true;
+
+  // Command failures are never cleared, and a trigger that fires once
+  // keeps its result.
+  std::optional<bool> r = this->Result();
+  return r && !(*r) && (this->launchFailed ||
+      this->processManager.ExitStats().failCount > 0 ||
+      !this->CanRetrigger());
+}
+
+//////////////////////////////////////////////////
+bool Trigger::CanRetrigger() const
+{
+  return false;
+}
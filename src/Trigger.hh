@@ -18,6 +18,8 @@
 #define GZ_TEST_TRIGGER_HH_
 
 #include <yaml-cpp/yaml.h>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <string>
 #include <vector>
@@ -27,6 +29,7 @@
 #include <gz/sim/World.hh>
 
 #include "gz/test/config.hh"
+#include "Expression.hh"
 #include "ProcessManager.hh"
 
 namespace gz
@@ -37,6 +40,13 @@ namespace gz
     inline namespace GZ_TEST_VERSION_NAMESPACE {
     class Test;
 
+    /// \brief A function that a trigger exposes to expressions, such as
+    /// "contains" in "region.contains(x1)". The first argument is the
+    /// parameter text. When the parameter names a model, the second
+    /// argument is the model entity, otherwise it is kNullEntity.
+    using TriggerFunction =
+      std::function<bool(const std::string &, const sim::Entity &)>;
+
     /// \brief Base class for all test triggers.
     class Trigger
     {
@@ -68,7 +78,9 @@ namespace gz
       /// \return True on success.
       public: bool LoadOnCommands(const YAML::Node &_node);
 
-      /// \brief Check the expectationsj
+      /// \brief Check the expectationsj. Expectations that can't be
+      /// evaluated, such as one on the exit code of a command that hasn't
+      /// exited, count as failed.
       /// \return True on success.
       public: bool CheckExpectations(const sim::UpdateInfo &_info,
                   Test *_test, const sim::EntityComponentManager &_ecm);
@@ -100,33 +112,58 @@ namespace gz
       public: void SetTriggered(bool _triggered);
       public: bool Triggered() const;
 
-      public: std::optional<bool> ParseFunction(Test *_test,
-                  const std::string &_str);
+      /// \brief Get whether the trigger failed in a way that later updates
+      /// can't change, such as a failed assertion or a failed on command.
+      /// \return True if the trigger failed for good.
+      public: bool HasFailed() const;
 
       public: std::optional<bool> RunFunction(const std::string &_name,
-                  const std::string &_param);
+                  const std::string &_param, const sim::Entity &_entity);
+
+      /// \brief Get a function registered by this trigger.
+      /// \param[in] _name Name of the function.
+      /// \return Pointer to the function, or nullptr if the trigger does
+      /// not have a function with the given name.
+      public: const TriggerFunction *Function(
+                  const std::string &_name) const;
 
       public: void Stop();
 
+      /// \brief Log the output of the on commands to a directory.
+      /// \param[in] _path The directory.
+      public: void SetLogPath(const std::string &_path);
+
+      /// \brief Get the exit status and resource usage of the on commands
+      /// that exited.
+      /// \return The statistics.
+      public: ProcessManager::Stats CommandStats() const;
+
+      /// \brief Get the log files of the on commands.
+      /// \return Paths to the log files.
+      public: std::vector<std::string> LogFiles() const;
+
+      /// \brief Get the number of expectation checks that passed since the
+      /// trigger was reset.
+      /// \return The number of passed checks.
+      public: unsigned int ExpectationPassCount() const;
+
+      /// \brief Get the number of expectation checks that failed since the
+      /// trigger was reset.
+      /// \return The number of failed checks.
+      public: unsigned int ExpectationFailCount() const;
+
       /// \brief Reset the trigger. This clears the results.
       public: void Reset();
 
       protected: void RegisterFunction(const std::string &_name,
-                     std::function<bool(const std::string &)> &_func);
+                     TriggerFunction &_func);
 
       protected: virtual void ResetImpl() = 0;
 
-      private: std::optional<bool> ParseEquation(
-                   const sim::UpdateInfo &_info,
-                   const std::string &_str,
-                   const sim::EntityComponentManager &_ecm);
-      private: std::optional<double> ParseValue(const std::string &_str,
-                   const sim::UpdateInfo &_info,
-                   const sim::EntityComponentManager &_ecm);
-
-      private: std::optional<double> ParsePoseProperty(
-                   const math::Pose3d &_pose,
-                   const std::string &_propertyStr);
+      /// \brief Get whether the trigger can fire again, and so overwrite
+      /// a failed result.
+      /// \return True if the trigger can fire more than once.
+      protected: virtual bool CanRetrigger() const;
 
       private: std::string name{""};
 
@@ -134,13 +171,13 @@ namespace gz
 
       private: std::vector<std::string> commands;
 
-      /// \brief The list of expectations. The first element in the
-      /// pair is the expectation, the second is whether or not the
+      /// \brief The list of compiled expectations. The first element in
+      /// the pair is the expectation, the second is whether or not the
       /// expectation is an assertion (true if assertion).
-      private: std::vector<std::pair<std::string, bool>> expectations;
+      private: std::vector<std::pair<std::unique_ptr<Expression>, bool>>
+               expectations;
 
-      private: std::map<std::string, std::function<bool(const std::string &)>>
-               functions;
+      private: std::map<std::string, TriggerFunction> functions;
 
       /// \brief Optional result, where std::nullopt means that there is no
       /// result.
@@ -149,6 +186,19 @@ namespace gz
       /// \brief True if the trigger was triggered.
       private: bool triggered{false};
 
+      /// \brief True if an assertion failed since the trigger was reset.
+      private: bool assertionFailed{false};
+
+      /// \brief Number of expectation checks that passed.
+      private: unsigned int expectationPassCount{0};
+
+      /// \brief Number of expectation checks that failed.
+      private: unsigned int expectationFailCount{0};
+
+      /// \brief True if launching the on commands failed. Set from the
+      /// process manager's launcher thread.
+      private: std::atomic<bool> launchFailed{false};
+
       private: ProcessManager processManager;
     };
     }
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2022 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef _WIN32
+
+#include <gtest/gtest.h>
+#include <yaml-cpp/yaml.h>
+
+#include <gz/sim/EntityComponentManager.hh>
+
+#include "Test.hh"
+#include "Trigger.hh"
+
+using namespace gz;
+using namespace test;
+
+/////////////////////////////////////////////////
+TEST(Trigger, ExpectationOnUnexitedCommandFails)
+{
+  // The "command" trigger never fires, so it has no exit code.
+  YAML::Node node = YAML::Load(R"(
+name: exit-code
+triggers:
+  - name: command
+    type: time
+    time: {duration: "0 00:00:01.000", type: sim}
+  - name: check
+    type: time
+    time: {duration: "0 00:00:02.000", type: sim}
+    on:
+      - expect: ${{command.exit_code == 0}}
+)");
+
+  Test test;
+  ASSERT_TRUE(test.Load(node));
+  Trigger *check = test.TriggerByName("check");
+  ASSERT_NE(nullptr, check);
+
+  sim::UpdateInfo info;
+  sim::EntityComponentManager ecm;
+  EXPECT_FALSE(check->CheckExpectations(info, &test, ecm));
+  EXPECT_EQ(0u, check->ExpectationPassCount());
+  EXPECT_EQ(1u, check->ExpectationFailCount());
+}
+
+/////////////////////////////////////////////////
+TEST(Trigger, AssertionOnUnexitedCommandFails)
+{
+  YAML::Node node = YAML::Load(R"(
+name: exit-code
+triggers:
+  - name: command
+    type: time
+    time: {duration: "0 00:00:01.000", type: sim}
+  - name: check
+    type: time
+    time: {duration: "0 00:00:02.000", type: sim}
+    on:
+      - assert: ${{command.exit_code == 0}}
+)");
+
+  Test test;
+  ASSERT_TRUE(test.Load(node));
+  Trigger *check = test.TriggerByName("check");
+  ASSERT_NE(nullptr, check);
+
+  sim::UpdateInfo info;
+  sim::EntityComponentManager ecm;
+  EXPECT_FALSE(check->CheckExpectations(info, &test, ecm));
+  EXPECT_TRUE(check->HasFailed());
+}
@@ -58,6 +58,14 @@ namespace gz
         return {seconds, nanoseconds};
       }
 
+      inline std::chrono::system_clock::time_point secNsecToTimePoint(
+        int64_t _sec, int64_t _nsec)
+      {
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::seconds(_sec) + std::chrono::nanoseconds(_nsec)));
+      }
+
     }
   }
 }
@@ -67,6 +67,48 @@ int main(int argc, char **argv)
   app.add_option("-v,--verbose",
       verbose, "Verbosity level");
 
+  unsigned int jobs = 1;
+  app.add_option("-j,--jobs",
+      jobs, "Number of tests to run in parallel, each in its own worker "
+      "process. Parameter searches run one test at a time")
+    ->check(CLI::PositiveNumber);
+
+  unsigned int processes = 1;
+  app.add_option("-p,--processes",
+      processes, "Number of worker processes to shard the tests across")
+    ->check(CLI::PositiveNumber);
+
+  std::string resultFormat = "pbtxt";
+  app.add_option("--result-format",
+      resultFormat, "Format of the scenario result: pbtxt, binary or json")
+    ->check(CLI::IsMember({"pbtxt", "binary", "json"}));
+
+  double progressRate = 1.0;
+  app.add_option("--progress-rate",
+      progressRate, "Rate, in Hz, at which the progress of each running "
+      "test is published on /test/progress. Zero disables progress")
+    ->check(CLI::NonNegativeNumber);
+
+  bool streamJson = false;
+  app.add_flag("--jsonl",
+      streamJson, "Also stream each test result as a line of JSON to "
+      "results.jsonl in the output path");
+
+  std::string cachePath = "";
+  app.add_option("--cache-path",
+      cachePath, "Directory used to cache resolved models. Defaults to "
+      "~/.gz/test/cache");
+
+  bool offline = false;
+  app.add_flag("--offline",
+      offline, "Never use the network, resolve resources from the cache");
+
+  // Options used internally to launch worker processes.
+  std::string workerDir = "";
+  unsigned int workerId = 0;
+  app.add_option("--worker-dir", workerDir)->group("");
+  app.add_option("--worker-id", workerId)->group("");
+
   CLI11_PARSE(app, argc, argv);
 
   // Set verbosity
@@ -111,15 +153,42 @@ int main(int argc, char **argv)
 
   // Load the scenario file.
   Scenario scenario;
+  if (!cachePath.empty())
+    scenario.SetCachePath(cachePath);
+  scenario.SetOffline(offline);
+  scenario.SetJobs(workerDir.empty() ? jobs : 1);
   if (!scenario.Load(scenarioFilename, outputPath))
   {
     gzerr << "Failed to load the scenario file[" << scenarioFilename << "]\n";
     return -1;
   }
 
+  scenario.SetProgressRate(progressRate);
+
+  // Run the tests assigned to this worker process.
+  if (!workerDir.empty())
+  {
+    scenario.RunWorker(workerDir, workerId);
+    return 0;
+  }
+
   // Run the tests
   if (kRun)
   {
+    scenario.SetStreamJson(streamJson);
+    if (resultFormat == "binary")
+      scenario.SetResultFormat(Scenario::ResultFormat::BINARY);
+    else if (resultFormat == "json")
+      scenario.SetResultFormat(Scenario::ResultFormat::JSON);
+    std::vector<std::string> workerCmd = {argv[0], "-s", scenarioFilename,
+        "-o", outputPath, "-v", std::to_string(verbose)};
+    if (!cachePath.empty())
+      workerCmd.insert(workerCmd.end(), {"--cache-path", cachePath});
+    if (offline)
+      workerCmd.push_back("--offline");
+    workerCmd.insert(workerCmd.end(),
+        {"--progress-rate", std::to_string(progressRate)});
+    scenario.SetProcesses(processes, workerCmd);
     scenario.Run();
 
     // If keep alive, send done messages at 1hz